@@ -0,0 +1,521 @@
+/*
+ * main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "./Source/PublicApi/rtos.hpp"
+#include "./External/CMSIS/Device/ST/STM32F2xx/Include/stm32f207xx.h"
+
+
+/* This sample measures the latency of the kernel operations with the cycle counter (DWT->CYCCNT)
+ *  and prints min, median, p99 and max of each operation as CSV over semihosting.
+ * Only core peripherals are used, so the image runs on the MPS2 AN385 board emulated by QEMU:
+ *
+ *   qemu-system-arm -M mps2-an385 -nographic -semihosting -icount shift=0 -kernel main.elf
+ *
+ * With -icount the execution is deterministic, so the output can be compared across releases.
+ * The output starts with a line "# ..." followed by the CSV header, and QEMU exits with status 0 once all benchmarks are complete.
+ *
+ * Benchmarks (all values are in core cycles and include the two reads of the cycle counter, see timer_overhead):
+ *   context_switch        relinquish() in one thread until the other thread of equal priority resumes
+ *   relinquish_pingpong   relinquish() round trip through another thread of equal priority
+ *   mutex_lock            Mutex::lock() on a free mutex
+ *   mutex_unlock          Mutex::unlock() without waiters
+ *   mutex_handoff         Mutex::unlock() in a low-priority thread until a blocked high-priority thread returns from lock()
+ *   queue_handoff         MessageQueue::push() in a low-priority thread until a blocked high-priority thread returns from pull()
+ *   sleep_1_tick          Interval between consecutive wake-ups of sleep(1) (the nominal value is one tick)
+ *   alloc                 RTOS::alloc() of 8 to 512 bytes
+ *   free                  RTOS::free() of the blocks above
+ *   churn_alloc           RTOS::alloc() of 16 bytes to about 2 KiB in a heap already churned by ChurnOperationCount mixed-size alloc/free pairs
+ *   churn_free            RTOS::free() of a random live block of the same workload
+ * The churn benchmarks are followed by a line "# heap ..." with RTOS::get_memory_statistics, i.e. the fragmentation left by the workload.
+ * The allocator is selected by RTOSImpl::UseTlsfAllocator, so that both backends can be compared on the same workload.
+ * main_<configuration>.elf is the same benchmark linked against each kernel configuration of kernel_configurations in meson.build,
+ *  e.g. to measure what the optional features (profiler, trace, cycle accounting ...) add to context_switch.
+ */
+
+
+
+
+// Semihosting
+
+void semihosting_write(char const * string)
+{
+	constexpr size_t const SYS_WRITE0 = 0x04;
+
+	register size_t r0 __asm("r0") = SYS_WRITE0;
+	register char const * r1 __asm("r1") = string;
+	__asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+}
+
+void semihosting_exit(bool success)
+{
+	constexpr size_t const SYS_EXIT = 0x18;
+	constexpr size_t const ADP_Stopped_ApplicationExit = 0x20026;
+	constexpr size_t const ADP_Stopped_RunTimeErrorUnknown = 0x20023;
+
+	register size_t r0 __asm("r0") = SYS_EXIT;
+	register size_t r1 __asm("r1") = success ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown;
+	__asm volatile("bkpt 0xAB" : : "r"(r0), "r"(r1) : "memory");
+	while (1);
+}
+
+extern "C" void HardFault_Handler(void)
+{
+	semihosting_exit(false);
+}
+
+
+
+
+// Statistics
+
+constexpr size_t const SampleCount = 1000;
+
+size_t g_samples[SampleCount];
+size_t volatile g_sample_count = 0;
+
+inline size_t get_cycle(void)
+{
+	return DWT->CYCCNT;
+}
+
+inline void record_sample(size_t cycle)
+{
+	if (g_sample_count < SampleCount) // Threads of a finished benchmark may still run briefly
+	{
+		g_samples[g_sample_count] = cycle;
+		g_sample_count = g_sample_count + 1;
+	}
+}
+
+char * append_string(char * buffer, char const * string)
+{
+	while (*string != '\0')
+	{
+		*buffer++ = *string++;
+	}
+	return buffer;
+}
+
+char * append_number(char * buffer, size_t number)
+{
+	char digits[12];
+	size_t count = 0;
+	do
+	{
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	}
+	while (number != 0);
+
+	while (count > 0)
+	{
+		*buffer++ = digits[--count];
+	}
+	return buffer;
+}
+
+void report_memory(void)
+{
+	RTOS::MemoryStatistics statistics;
+	RTOS::get_memory_statistics(statistics);
+
+	char line[160];
+	char * end = line;
+	end = append_string(end, "# heap used=");
+	end = append_number(end, statistics.used_size);
+	end = append_string(end, " unused=");
+	end = append_number(end, statistics.unused_size);
+	end = append_string(end, " largest_free=");
+	end = append_number(end, statistics.largest_free_size);
+	end = append_string(end, " fragmentation_permille=");
+	end = append_number(end, statistics.fragmentation_permille);
+	end = append_string(end, "\n");
+	*end = '\0';
+	semihosting_write(line);
+
+	RTOS::HeapStatistics heap_statistics;
+	RTOS::get_heap_statistics(heap_statistics);
+
+	end = line;
+	end = append_string(end, "# heap live=");
+	end = append_number(end, heap_statistics.live_count);
+	end = append_string(end, " live_size=");
+	end = append_number(end, heap_statistics.live_size);
+	end = append_string(end, " peak_size=");
+	end = append_number(end, heap_statistics.peak_size);
+	end = append_string(end, " peak_used=");
+	end = append_number(end, heap_statistics.peak_used_size);
+	end = append_string(end, " allocs=");
+	end = append_number(end, heap_statistics.alloc_count);
+	end = append_string(end, "\n");
+	*end = '\0';
+	semihosting_write(line);
+}
+
+void sort_samples(size_t * samples, size_t count)
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		size_t value = samples[i];
+		size_t j = i;
+		while (j > 0 && samples[j - 1] > value)
+		{
+			samples[j] = samples[j - 1];
+			j--;
+		}
+		samples[j] = value;
+	}
+}
+
+void report(char const * name)
+// Print one CSV line for the samples collected so far and reset the sample buffer
+{
+	size_t count = g_sample_count;
+	if (count == 0)
+	{
+		semihosting_exit(false);
+	}
+	sort_samples(g_samples, count);
+
+	char line[128];
+	char * end = line;
+	end = append_string(end, name);
+	end = append_string(end, ",");
+	end = append_number(end, count);
+	end = append_string(end, ",");
+	end = append_number(end, g_samples[0]);
+	end = append_string(end, ",");
+	end = append_number(end, g_samples[count / 2]);
+	end = append_string(end, ",");
+	end = append_number(end, g_samples[(count * 99) / 100]);
+	end = append_string(end, ",");
+	end = append_number(end, g_samples[count - 1]);
+	end = append_string(end, "\n");
+	*end = '\0';
+	semihosting_write(line);
+
+	g_sample_count = 0;
+}
+
+
+
+
+// Benchmarks running on os_main
+
+void benchmark_timer_overhead(void)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t start = get_cycle();
+		record_sample(get_cycle() - start);
+	}
+}
+
+RTOS::Mutex g_mutex;
+
+void benchmark_mutex_lock(void)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t start = get_cycle();
+		g_mutex.lock();
+		record_sample(get_cycle() - start);
+		g_mutex.unlock();
+	}
+}
+
+void benchmark_mutex_unlock(void)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		g_mutex.lock();
+		size_t start = get_cycle();
+		g_mutex.unlock();
+		record_sample(get_cycle() - start);
+	}
+}
+
+void * g_blocks[SampleCount];
+
+void benchmark_alloc(void)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t size = 8u << (2 * (i % 4)); // 8, 32, 128 and 512 bytes
+		size_t start = get_cycle();
+		g_blocks[i] = RTOS::alloc(size);
+		record_sample(get_cycle() - start);
+		if (g_blocks[i] == nullptr)
+		{
+			semihosting_exit(false);
+		}
+	}
+}
+
+void benchmark_free(void)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t index = (i * 7) % SampleCount; // Free in an order different from the allocation order
+		size_t start = get_cycle();
+		RTOS::free(g_blocks[index]);
+		record_sample(get_cycle() - start);
+	}
+}
+
+constexpr size_t const ChurnSlotCount = 256; // Live blocks of the churn workload
+constexpr size_t const ChurnOperationCount = 100000;
+
+void * g_churn_blocks[ChurnSlotCount];
+uint32_t g_churn_seed = 1;
+
+size_t get_churn_random(void)
+{
+	g_churn_seed = g_churn_seed * 1664525u + 1013904223u;
+	return g_churn_seed >> 8;
+}
+
+size_t get_churn_size(void)
+// Mostly small blocks with a tail of large ones, as with messages and per-request buffers
+{
+	size_t random = get_churn_random();
+	return (16u << (random % 8)) + (random >> 8) % 16 * 8; // 16 to 2168 bytes
+}
+
+void churn_step(bool measure_alloc)
+// Replace a random live block with a block of random size
+{
+	size_t slot = get_churn_random() % ChurnSlotCount;
+	if (g_churn_blocks[slot] != nullptr)
+	{
+		size_t start = get_cycle();
+		RTOS::free(g_churn_blocks[slot]);
+		size_t duration = get_cycle() - start;
+		if (!measure_alloc) {record_sample(duration);}
+	}
+
+	size_t size = get_churn_size();
+	size_t start = get_cycle();
+	g_churn_blocks[slot] = RTOS::alloc(size);
+	size_t duration = get_cycle() - start;
+	if (measure_alloc) {record_sample(duration);}
+	if (g_churn_blocks[slot] == nullptr)
+	{
+		semihosting_exit(false);
+	}
+}
+
+void benchmark_churn(bool measure_alloc)
+{
+	g_sample_count = SampleCount; // Discard the samples of the warm-up
+	for (size_t i = 0; i < ChurnOperationCount; i++)
+	{
+		churn_step(measure_alloc);
+	}
+
+	g_sample_count = 0;
+	while (g_sample_count < SampleCount)
+	{
+		churn_step(measure_alloc);
+	}
+}
+
+
+
+
+// Benchmarks running on worker threads
+
+constexpr size_t const HighPriority = 3;
+constexpr size_t const LowPriority = 4;
+constexpr size_t const WorkerStackSize = 0x300;
+
+RTOS::MessageQueue g_done_queue; // A worker posts on this queue when its benchmark is complete
+RTOS::MessageQueue g_handoff_queue;
+size_t volatile g_switch_start;
+bool volatile g_stop;
+
+
+size_t context_switch_procedure(size_t arg)
+{
+	while (g_sample_count < SampleCount)
+	{
+		g_switch_start = get_cycle();
+		RTOS::relinquish(); // The other thread resumes here and records the switch
+		record_sample(get_cycle() - g_switch_start);
+	}
+	if (arg == 0)
+	{
+		g_done_queue.push(0);
+	}
+	return 0;
+}
+
+size_t pingpong_procedure(size_t arg)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t start = get_cycle();
+		RTOS::relinquish();
+		record_sample(get_cycle() - start);
+	}
+	g_stop = true;
+	g_done_queue.push(0);
+	return 0;
+}
+
+size_t pingpong_peer_procedure(size_t arg)
+{
+	while (!g_stop)
+	{
+		RTOS::relinquish();
+	}
+	return 0;
+}
+
+size_t mutex_handoff_high_procedure(size_t arg)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		g_handoff_queue.pull(); // Wait until the low-priority thread owns the mutex
+		g_mutex.lock(); // Block until the low-priority thread unlocks
+		record_sample(get_cycle() - g_switch_start);
+		g_mutex.unlock();
+	}
+	return 0;
+}
+
+size_t mutex_handoff_low_procedure(size_t arg)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		g_mutex.lock();
+		g_handoff_queue.push(0); // The high-priority thread runs and blocks on the mutex
+		g_switch_start = get_cycle();
+		g_mutex.unlock();
+	}
+	g_done_queue.push(0);
+	return 0;
+}
+
+size_t queue_handoff_high_procedure(size_t arg)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		size_t start = g_handoff_queue.pull();
+		record_sample(get_cycle() - start);
+	}
+	return 0;
+}
+
+size_t queue_handoff_low_procedure(size_t arg)
+{
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		g_handoff_queue.push(get_cycle());
+	}
+	g_done_queue.push(0);
+	return 0;
+}
+
+size_t sleep_procedure(size_t arg)
+{
+	RTOS::sleep(1); // Align to a tick
+	size_t last_wakeup = get_cycle();
+	for (size_t i = 0; i < SampleCount; i++)
+	{
+		RTOS::sleep(1);
+		size_t wakeup = get_cycle();
+		record_sample(wakeup - last_wakeup);
+		last_wakeup = wakeup;
+	}
+	g_done_queue.push(0);
+	return 0;
+}
+
+
+RTOS::StaticThread<WorkerStackSize> g_context_switch_threads[2];
+RTOS::StaticThread<WorkerStackSize> g_pingpong_threads[2];
+RTOS::StaticThread<WorkerStackSize> g_mutex_handoff_threads[2];
+RTOS::StaticThread<WorkerStackSize> g_queue_handoff_threads[2];
+RTOS::StaticThread<WorkerStackSize> g_sleep_thread;
+
+
+void wait_for_workers(void)
+{
+	g_done_queue.pull();
+	RTOS::sleep(2); // Let the remaining workers of the benchmark terminate before the sample buffer is reused
+}
+
+
+size_t os_main(size_t arg)
+{
+	g_done_queue.initialize(1);
+	g_handoff_queue.initialize(1);
+
+	semihosting_write("# RTOS kernel benchmark, unit: core cycles\n");
+	semihosting_write("benchmark,samples,min,median,p99,max\n");
+
+	benchmark_timer_overhead();
+	report("timer_overhead");
+
+	g_context_switch_threads[0].initialize(&context_switch_procedure, 0, LowPriority);
+	g_context_switch_threads[1].initialize(&context_switch_procedure, 1, LowPriority);
+	wait_for_workers();
+	report("context_switch");
+
+	g_stop = false;
+	g_pingpong_threads[0].initialize(&pingpong_procedure, LowPriority);
+	g_pingpong_threads[1].initialize(&pingpong_peer_procedure, LowPriority);
+	wait_for_workers();
+	report("relinquish_pingpong");
+
+	benchmark_mutex_lock();
+	report("mutex_lock");
+
+	benchmark_mutex_unlock();
+	report("mutex_unlock");
+
+	g_mutex_handoff_threads[0].initialize(&mutex_handoff_high_procedure, HighPriority);
+	g_mutex_handoff_threads[1].initialize(&mutex_handoff_low_procedure, LowPriority);
+	wait_for_workers();
+	report("mutex_handoff");
+
+	g_queue_handoff_threads[0].initialize(&queue_handoff_high_procedure, HighPriority);
+	g_queue_handoff_threads[1].initialize(&queue_handoff_low_procedure, LowPriority);
+	wait_for_workers();
+	report("queue_handoff");
+
+	g_sleep_thread.initialize(&sleep_procedure, HighPriority);
+	wait_for_workers();
+	report("sleep_1_tick");
+
+	benchmark_alloc();
+	report("alloc");
+
+	benchmark_free();
+	report("free");
+
+	benchmark_churn(true);
+	report("churn_alloc");
+
+	benchmark_churn(false);
+	report("churn_free");
+	report_memory();
+
+	semihosting_exit(true);
+	return 0;
+}
+
+
+__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x100000]; // Large enough for the blocks of the alloc benchmark
+
+int main(void)
+{
+  RTOS::initialize(&os_main, 0x400, g_os_heap, sizeof(g_os_heap));
+}
@@ -0,0 +1,121 @@
+/*
+ * main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include <stddef.h>
+#include "./Source/PublicApi/rtos.hpp"
+
+
+/* This sample verifies that the floating-point context of each thread survives context switches on the Cortex-M4F port.
+ * Two threads of equal priority keep partial sums in floating-point registers while relinquishing to each other,
+ *  and a third thread switches in between without touching the FPU (its frames carry no floating-point context).
+ * Every partial sum is exactly representable, so any corruption of s0-s31 or FPSCR changes the result.
+ * Only core peripherals are used, so the image runs on the MPS2 AN386 board emulated by QEMU:
+ *
+ *   qemu-system-arm -M mps2-an386 -nographic -semihosting -kernel main.elf
+ *
+ * QEMU exits with status 0 if all the sums are exact, and with a non-zero status otherwise.
+ */
+
+
+
+
+// Semihosting
+
+void semihosting_exit(bool success)
+{
+	constexpr size_t const SYS_EXIT = 0x18;
+	constexpr size_t const ADP_Stopped_ApplicationExit = 0x20026;
+	constexpr size_t const ADP_Stopped_RunTimeErrorUnknown = 0x20023;
+
+	register size_t r0 __asm("r0") = SYS_EXIT;
+	register size_t r1 __asm("r1") = success ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown;
+	__asm volatile("bkpt 0xAB" : : "r"(r0), "r"(r1) : "memory");
+	while (1);
+}
+
+
+extern "C" void HardFault_Handler(void)
+{
+	semihosting_exit(false);
+}
+
+
+
+
+// Threads
+
+constexpr size_t const IterationCount = 1000;
+constexpr size_t const FloatThreadCount = 2;
+
+size_t volatile g_finished_count = 0;
+size_t volatile g_integer_switch_count = 0;
+
+
+size_t float_procedure(size_t arg)
+{
+	float const step = static_cast<float>(arg) * 0.25f;
+	float sum_a = 0.0f;
+	float sum_b = 0.0f;
+	float sum_c = 0.0f;
+	float sum_d = 0.0f;
+
+	for (size_t i = 0; i < IterationCount; i++)
+	{
+		sum_a += step;
+		sum_b -= step;
+		sum_c += 2.0f * step;
+		sum_d = sum_d * 0.5f + step;
+
+		RTOS::relinquish(); // The partial sums are live in callee-saved registers s16-s31 across the switch
+	}
+
+	float const expected = static_cast<float>(IterationCount) * step;
+	bool const success = (sum_a == expected) && (sum_b == -expected) && (sum_c == 2.0f * expected)
+		&& (sum_d > step * 1.99f) && (sum_d <= step * 2.0f);
+	if (!success)
+	{
+		semihosting_exit(false);
+	}
+
+	if (++g_finished_count == FloatThreadCount)
+	{
+		semihosting_exit(g_integer_switch_count > 0);
+	}
+	return 0;
+}
+
+size_t integer_procedure(size_t arg)
+{
+	while (1)
+	{
+		g_integer_switch_count = g_integer_switch_count + 1;
+		RTOS::relinquish();
+	}
+	return 0;
+}
+
+
+RTOS::StaticThread<0x200> g_float_thread_1;
+RTOS::StaticThread<0x200> g_float_thread_2;
+RTOS::StaticThread<0x100> g_integer_thread;
+
+
+size_t os_main(size_t arg)
+{
+	g_float_thread_1.initialize(&float_procedure, 1, 5);
+	g_float_thread_2.initialize(&float_procedure, 3, 5);
+	g_integer_thread.initialize(&integer_procedure, 5);
+	return 0;
+}
+
+
+__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x1000];
+
+int main(void)
+{
+  RTOS::initialize(&os_main, 0x200, g_os_heap, sizeof(g_os_heap));
+}
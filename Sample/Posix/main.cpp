@@ -0,0 +1,152 @@
+/*
+ * main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "./Source/PublicApi/rtos.hpp"
+
+
+/* This sample runs the kernel natively as a Linux process (POSIX port, see Source/Driver/posix_core.hpp).
+ * A producer and a consumer exchange messages through a MessageQueue while sharing a Mutex-protected counter,
+ *  and a third thread sleeps periodically so that the tick, sleep and idle paths are exercised as well.
+ * The program prints the throughput and exits with status 0 if every message arrived in order.
+ * If a file name is given as argument, the scheduler trace of the last events is written to it, e.g.
+ *
+ *   ./build/Sample/Posix/main trace.bin && python3 Tools/rtos_trace.py trace.bin -o trace.json
+ *
+ * It is built by a native (non-cross) meson setup and can be profiled directly, e.g.
+ *
+ *   perf record ./build/Sample/Posix/main
+ */
+
+
+
+
+// Host utilities
+
+double get_wall_time(void)
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+char const * g_trace_file_name = nullptr;
+
+bool write_trace(void)
+{
+	RTOS::set_tracing(false);
+	if (g_trace_file_name == nullptr) {return true;}
+
+	size_t size;
+	void const * buffer = RTOS::get_trace_buffer(size);
+	FILE * file = fopen(g_trace_file_name, "wb");
+	if (file == nullptr) {return false;}
+	bool success = fwrite(buffer, 1, size, file) == size;
+	return (fclose(file) == 0) && success;
+}
+
+
+
+
+// Threads
+
+constexpr size_t const MessageCount = 1000000;
+constexpr size_t const QueueCapacity = 16;
+constexpr size_t const StackSize = 0x10000; // The SIGALRM handler runs on thread stacks, see posix_core.hpp
+constexpr size_t const SleepTime = 10;
+
+RTOS::MessageQueue g_queue;
+RTOS::Mutex g_mutex;
+size_t g_shared_counter = 0;
+size_t volatile g_sleep_count = 0;
+double g_start_time;
+
+
+size_t producer_procedure(size_t arg)
+{
+	for (size_t i = 0; i < MessageCount; i++)
+	{
+		while (!g_queue.push(i))
+		{
+			RTOS::relinquish(); // The queue is full; let the consumer drain it
+		}
+
+		g_mutex.lock();
+		g_shared_counter++;
+		g_mutex.unlock();
+	}
+	return 0;
+}
+
+size_t consumer_procedure(size_t arg)
+{
+	bool success = true;
+	for (size_t i = 0; i < MessageCount; i++)
+	{
+		success &= (g_queue.pull() == i);
+
+		g_mutex.lock();
+		g_shared_counter++;
+		g_mutex.unlock();
+	}
+
+	double elapsed_time = get_wall_time() - g_start_time;
+	g_mutex.lock();
+	success &= (g_shared_counter >= MessageCount); // The producer may not have recorded its last message yet
+	g_mutex.unlock();
+	success &= write_trace();
+
+	printf("%zu messages in %.3f s (%.0f messages/s), %zu sleeps, used memory %zu bytes\n",
+			MessageCount, elapsed_time, MessageCount / elapsed_time, (size_t) g_sleep_count, RTOS::used_memory());
+	printf("%s\n", success ? "PASS" : "FAIL");
+	fflush(stdout);
+	_Exit(success ? EXIT_SUCCESS : EXIT_FAILURE); // Skip static destructors: the threads and the queue are still in use
+	return 0;
+}
+
+size_t sleeper_procedure(size_t arg)
+{
+	while (1)
+	{
+		RTOS::sleep(SleepTime);
+		g_sleep_count = g_sleep_count + 1;
+	}
+	return 0;
+}
+
+
+RTOS::Thread g_producer_thread;
+RTOS::Thread g_consumer_thread;
+RTOS::Thread g_sleeper_thread;
+
+
+size_t os_main(size_t arg)
+{
+	g_queue.initialize(QueueCapacity);
+	g_start_time = get_wall_time();
+
+	g_sleeper_thread.initialize(&sleeper_procedure, 2, StackSize);
+	g_consumer_thread.initialize(&consumer_procedure, 5, StackSize);
+	g_producer_thread.initialize(&producer_procedure, 5, StackSize);
+	return 0;
+}
+
+
+alignas(16) char g_os_heap[0x100000];
+
+int main(int argc, char ** argv)
+{
+	if (argc > 1)
+	{
+		g_trace_file_name = argv[1];
+	}
+
+	RTOS::initialize(&os_main, StackSize, g_os_heap, sizeof(g_os_heap));
+}
@@ -10,6 +10,18 @@
 #include "./External/CMSIS/Device/ST/STM32F2xx/Include/stm32f207xx.h"
 
 
+/* With SLEEP_SAMPLE_SELF_CHECK, the sample checks itself and reports over semihosting. compilation_setup_netduino2.txt builds it so,
+ *  with TIM2 as the tick timer, for the STM32F205 of the netduino2 board emulated by QEMU:
+ *
+ *   meson setup --cross-file ./compilation_setup_netduino2.txt build_netduino2
+ *   qemu-system-arm -M netduino2 -nographic -semihosting -icount shift=0,sleep=off -kernel ./build_netduino2/Sample/Sleep/main.elf
+ *
+ * A check thread lets the threads below run for CheckRunTime, stops them, then sleeps for LongSleepTime, beyond the 8 s reach of SysTick.
+ * QEMU exits with status 0 if the LED kept toggling, the long sleep lasted its number of ticks, and the idle thread slept through it at once.
+ * The check fails at once if the emulator does not model the cycle counter, which the kernel needs (QEMU may not implement DWT).
+ */
+
+
 
 
 
@@ -35,14 +47,80 @@ void toggle_green_led(void)
 
 
 
+#ifdef SLEEP_SAMPLE_SELF_CHECK
+
+// Semihosting
+
+void semihosting_write(char const * string)
+{
+	constexpr size_t const SYS_WRITE0 = 0x04;
+
+	register size_t r0 __asm("r0") = SYS_WRITE0;
+	register char const * r1 __asm("r1") = string;
+	__asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+}
+
+void semihosting_exit(bool success)
+{
+	constexpr size_t const SYS_EXIT = 0x18;
+	constexpr size_t const ADP_Stopped_ApplicationExit = 0x20026;
+	constexpr size_t const ADP_Stopped_RunTimeErrorUnknown = 0x20023;
+
+	register size_t r0 __asm("r0") = SYS_EXIT;
+	register size_t r1 __asm("r1") = success ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown;
+	__asm volatile("bkpt 0xAB" : : "r"(r0), "r"(r1) : "memory");
+	while (1);
+}
+
+extern "C" void HardFault_Handler(void)
+{
+	semihosting_exit(false);
+}
+
+char * append_string(char * buffer, char const * string)
+{
+	while (*string != '\0')
+	{
+		*buffer++ = *string++;
+	}
+	return buffer;
+}
+
+char * append_number(char * buffer, size_t number)
+{
+	char digits[12];
+	size_t count = 0;
+	do
+	{
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	}
+	while (number != 0);
+
+	while (count > 0)
+	{
+		*buffer++ = digits[--count];
+	}
+	return buffer;
+}
+
+#endif
+
+
+
+
 // Threads
 
+bool volatile g_stop = false; // Only set by the self-check
+size_t volatile g_toggle_count = 0;
+
 size_t toggle_green_procedure(size_t arg)
 {
 	enable_green_led();
-	while(1)
+	while(!g_stop)
 	{
 		toggle_green_led();
+		g_toggle_count++;
 		RTOS::sleep(1000);
 	}
 	return 0;
@@ -65,7 +143,7 @@ size_t volatile g_long_sleep_syscall_latency = 0;
 
 size_t do_useless_work(size_t arg)
 {
-	while(1)
+	while(!g_stop)
 	{
 		g_last_systick = RTOS::system_time();
 		g_last_sleep_time = arg;
@@ -100,12 +178,71 @@ size_t do_useless_work(size_t arg)
 			__NOP();
 		}
 	}
+	return 0;
+}
+
+/* The threads carry their stacks (StaticThread), hence creating them requires no heap allocation.
+ * The heap below is only used by the first thread and internal RTOS structures.
+ */
+RTOS::StaticThread<0x100> g_toggle_led_thread;
+RTOS::StaticThread<0x100> g_high_freq_useless_thread[30];
+RTOS::StaticThread<0x100> g_med_freq_useless_thread[30];
+RTOS::StaticThread<0x100> g_low_freq_useless_thread[30];
+
+
+#ifdef SLEEP_SAMPLE_SELF_CHECK
+
+constexpr size_t const CheckRunTime = 5000; // In ticks
+constexpr size_t const LongSleepTime = 40000; // In ticks; SysTick would need 5 countdowns
+
+size_t check_procedure(size_t arg)
+{
+	RTOS::sleep(CheckRunTime);
+	size_t toggle_count = g_toggle_count;
+	g_stop = true;
+	RTOS::sleep(LONG_SLEEP_TIME + 1); // Every thread sees g_stop and terminates
+
+	RTOS::reset_idle_statistics();
+	RTOS::TimeType start_time = RTOS::system_time();
+	RTOS::sleep(LongSleepTime);
+	size_t long_sleep_time = (size_t) (RTOS::system_time() - start_time);
+
+	RTOS::IdleStateStatistics statistics[4];
+	size_t state_count = RTOS::get_idle_statistics(statistics, 4);
+	size_t idle_entry_count = 0;
+	for (size_t i = 0; i < state_count && i < 4; i++)
+	{
+		idle_entry_count += statistics[i].entry_count;
+	}
+
+	bool success = toggle_count >= CheckRunTime / LONG_SLEEP_TIME
+			&& long_sleep_time >= LongSleepTime && long_sleep_time <= LongSleepTime + 1u
+			&& idle_entry_count <= 2u;
+
+	char line[200];
+	char * end = line;
+	end = append_string(end, "toggles ");
+	end = append_number(end, toggle_count);
+	end = append_string(end, ", long sleep ");
+	end = append_number(end, long_sleep_time);
+	end = append_string(end, " ticks in ");
+	end = append_number(end, idle_entry_count);
+	end = append_string(end, " idle entries, sleep latency ");
+	end = append_number(end, g_short_sleep_syscall_latency);
+	end = append_string(end, "/");
+	end = append_number(end, g_med_sleep_syscall_latency);
+	end = append_string(end, "/");
+	end = append_number(end, g_long_sleep_syscall_latency);
+	end = append_string(end, success ? " cycles: PASS\n" : " cycles: FAIL\n");
+	*end = '\0';
+	semihosting_write(line);
+	semihosting_exit(success);
+	return 0;
 }
 
-RTOS::Thread g_toggle_led_thread;
-RTOS::Thread g_high_freq_useless_thread[30];
-RTOS::Thread g_med_freq_useless_thread[30];
-RTOS::Thread g_low_freq_useless_thread[30];
+RTOS::StaticThread<0x200> g_check_thread;
+
+#endif
 
 
 size_t os_main(size_t arg)
@@ -117,28 +254,44 @@ size_t os_main(size_t arg)
 	 * If the useless threads cannot be executed timely, the LED will stop toggling.
 	 */
 
-	g_toggle_led_thread.initialize(&toggle_green_procedure, 2, 0x100);
+	g_toggle_led_thread.initialize(&toggle_green_procedure, 2);
+#ifdef SLEEP_SAMPLE_SELF_CHECK
+	g_check_thread.initialize(&check_procedure, 0);
+#endif
 
-	for (size_t i = 0; i < sizeof(g_high_freq_useless_thread) / sizeof(RTOS::Thread); i++)
+	for (size_t i = 0; i < sizeof(g_high_freq_useless_thread) / sizeof(g_high_freq_useless_thread[0]); i++)
 	{
-		g_high_freq_useless_thread[i].initialize(&do_useless_work, SHORT_SLEEP_TIME, 1, 0x100);
+		g_high_freq_useless_thread[i].initialize(&do_useless_work, SHORT_SLEEP_TIME, 1);
 	}
-	for (size_t i = 0; i < sizeof(g_med_freq_useless_thread) / sizeof(RTOS::Thread); i++)
+	for (size_t i = 0; i < sizeof(g_med_freq_useless_thread) / sizeof(g_med_freq_useless_thread[0]); i++)
 	{
-		g_med_freq_useless_thread[i].initialize(&do_useless_work, MED_SLEEP_TIME, 1, 0x100);
+		g_med_freq_useless_thread[i].initialize(&do_useless_work, MED_SLEEP_TIME, 1);
 	}
-	for (size_t i = 0; i < sizeof(g_low_freq_useless_thread) / sizeof(RTOS::Thread); i++)
+	for (size_t i = 0; i < sizeof(g_low_freq_useless_thread) / sizeof(g_low_freq_useless_thread[0]); i++)
 	{
-		g_low_freq_useless_thread[i].initialize(&do_useless_work, LONG_SLEEP_TIME, 1, 0x100);
+		g_low_freq_useless_thread[i].initialize(&do_useless_work, LONG_SLEEP_TIME, 1);
 	}
 
 	return 0;
 }
 
 
-__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x10000];
+__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x1000];
 
 int main(void)
 {
+#ifdef SLEEP_SAMPLE_SELF_CHECK
+  // The kernel keeps time with the cycle counter, which an emulator may not model; fail at once rather than hang
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  size_t cycle = DWT->CYCCNT;
+  for (size_t volatile i = 0; i < 100u; i++);
+  if (DWT->CYCCNT == cycle)
+  {
+    semihosting_write("The cycle counter (DWT->CYCCNT) does not run: FAIL\n");
+    semihosting_exit(false);
+  }
+#endif
+  RTOS::set_stack_painting(true); // The peak stack usage of every thread can then be read with RTOS::get_stack_usage_report
   RTOS::initialize(&os_main, 0x200, g_os_heap, sizeof(g_os_heap));
 }
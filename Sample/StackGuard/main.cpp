@@ -0,0 +1,93 @@
+/*
+ * main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include <stddef.h>
+#include "./Source/PublicApi/rtos.hpp"
+#include "./External/CMSIS/Device/ST/STM32F2xx/Include/stm32f207xx.h"
+
+
+/* This sample verifies the MPU stack guard: a thread recurses until it overflows its stack,
+ *  which must raise a MemManage fault as soon as the guard region below the stack is touched.
+ * Only core peripherals are used, so the image runs on the MPS2 AN385 board emulated by QEMU:
+ *
+ *   qemu-system-arm -M mps2-an385 -nographic -semihosting -kernel main.elf
+ *
+ * QEMU exits with status 0 if the overflow is caught by the MPU, and with a non-zero status otherwise.
+ */
+
+
+
+
+// Semihosting
+
+void semihosting_exit(bool success)
+{
+	constexpr size_t const SYS_EXIT = 0x18;
+	constexpr size_t const ADP_Stopped_ApplicationExit = 0x20026;
+	constexpr size_t const ADP_Stopped_RunTimeErrorUnknown = 0x20023;
+
+	register size_t r0 __asm("r0") = SYS_EXIT;
+	register size_t r1 __asm("r1") = success ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown;
+	__asm volatile("bkpt 0xAB" : : "r"(r0), "r"(r1) : "memory");
+	while (1);
+}
+
+
+
+
+// Fault handlers
+
+extern "C" void MemManage_Handler(void)
+{
+	// Either the stacking of an exception frame (MSTKERR) or a data access (DACCVIOL) hit the guard region
+	semihosting_exit(SCB->CFSR & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_DACCVIOL_Msk));
+}
+
+extern "C" void HardFault_Handler(void)
+{
+	semihosting_exit(false); // The overflow corrupted memory instead of being caught
+}
+
+
+
+
+// Threads
+
+size_t volatile g_recursion_depth = 0;
+
+size_t recurse(size_t depth)
+{
+	size_t volatile buffer[8]; // Consume stack quickly
+	buffer[0] = depth;
+	g_recursion_depth = depth;
+	return recurse(depth + 1) + buffer[0]; // Not a tail call, so every level keeps its frame
+}
+
+size_t overflow_procedure(size_t arg)
+{
+	recurse(0);
+	semihosting_exit(false); // Should not reach here
+	return 0;
+}
+
+
+RTOS::StaticThread<0x200> g_overflow_thread;
+
+
+size_t os_main(size_t arg)
+{
+	g_overflow_thread.initialize(&overflow_procedure, 5);
+	return 0;
+}
+
+
+__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x1000];
+
+int main(void)
+{
+  RTOS::initialize(&os_main, 0x200, g_os_heap, sizeof(g_os_heap));
+}
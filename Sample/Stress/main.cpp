@@ -0,0 +1,324 @@
+/*
+ * main.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "./Source/PublicApi/rtos.hpp"
+#include "./External/CMSIS/Device/ST/STM32F2xx/Include/stm32f207xx.h"
+
+
+/* This sample generalizes Sample/Sleep into a scalability test of the timer structures of the kernel.
+ * For each thread count in ThreadCounts, it starts a mix of threads that repeatedly
+ *   - sleep,
+ *   - wait on a mutex that is never released (Mutex::try_lock times out), or
+ *   - wait on a queue that stays empty (MessageQueue::try_pull times out),
+ *  with periods drawn from a set of primes so that expirations spread over the ticks and collide irregularly.
+ * During each run it records
+ *   - the longest SysTick handler (systick_update; the expirations themselves are processed in PendSV_Handler),
+ *   - the interrupt latency seen by a periodic timer interrupt of the highest priority,
+ *     which the kernel critical sections do not delay since they mask with BASEPRI (only the wake-up from WFI does),
+ *   - the lateness of each wake-up with respect to the SysTick handler of its expiration tick.
+ * One CSV line is printed per thread count over semihosting. The image runs on QEMU:
+ *
+ *   qemu-system-arm -M mps2-an385 -nographic -semihosting -icount shift=0 -kernel main.elf
+ */
+
+
+
+
+// Semihosting
+
+void semihosting_write(char const * string)
+{
+	constexpr size_t const SYS_WRITE0 = 0x04;
+
+	register size_t r0 __asm("r0") = SYS_WRITE0;
+	register char const * r1 __asm("r1") = string;
+	__asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+}
+
+void semihosting_exit(bool success)
+{
+	constexpr size_t const SYS_EXIT = 0x18;
+	constexpr size_t const ADP_Stopped_ApplicationExit = 0x20026;
+	constexpr size_t const ADP_Stopped_RunTimeErrorUnknown = 0x20023;
+
+	register size_t r0 __asm("r0") = SYS_EXIT;
+	register size_t r1 __asm("r1") = success ? ADP_Stopped_ApplicationExit : ADP_Stopped_RunTimeErrorUnknown;
+	__asm volatile("bkpt 0xAB" : : "r"(r0), "r"(r1) : "memory");
+	while (1);
+}
+
+extern "C" void HardFault_Handler(void)
+{
+	semihosting_exit(false);
+}
+
+char * append_string(char * buffer, char const * string)
+{
+	while (*string != '\0')
+	{
+		*buffer++ = *string++;
+	}
+	return buffer;
+}
+
+char * append_number(char * buffer, size_t number)
+{
+	char digits[12];
+	size_t count = 0;
+	do
+	{
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	}
+	while (number != 0);
+
+	while (count > 0)
+	{
+		*buffer++ = digits[--count];
+	}
+	return buffer;
+}
+
+
+
+
+// Measurements
+
+struct Statistics
+{
+	size_t volatile max_tick_handler;
+	size_t volatile min_irq_latency;
+	size_t volatile max_irq_latency;
+	size_t volatile max_wakeup_lateness;
+	std::atomic<size_t> late_wakeups; // Wake-ups that happened after the tick of their expiration
+	std::atomic<size_t> wakeups;
+};
+
+Statistics g_statistics;
+bool volatile g_recording = false;
+
+size_t volatile g_tick_entry_cycle; // Cycle count at the entry of the last SysTick handler
+
+
+extern "C" void SysTick_Handler(void); // Kernel handler
+
+extern "C" void Stress_SysTick_Handler(void)
+// Installed in the vector table in place of SysTick_Handler
+{
+	size_t entry_cycle = DWT->CYCCNT;
+	SysTick_Handler();
+	size_t duration = DWT->CYCCNT - entry_cycle;
+
+	g_tick_entry_cycle = entry_cycle;
+	if (g_recording && duration > g_statistics.max_tick_handler)
+	{
+		g_statistics.max_tick_handler = duration;
+	}
+}
+
+
+struct CmsdkTimer // APB timer of the MPS2 boards
+{
+	uint32_t volatile CTRL;
+	uint32_t volatile VALUE;
+	uint32_t volatile RELOAD;
+	uint32_t volatile INTCLEAR;
+};
+
+CmsdkTimer * const TIMER0 = reinterpret_cast<CmsdkTimer *>(0x40000000);
+constexpr IRQn_Type const TIMER0_IRQn = static_cast<IRQn_Type>(8);
+constexpr uint32_t const TimerReload = 9973; // Prime, so that the samples drift across the tick period
+constexpr uint32_t const TIMER_CTRL_ENABLE = 1u << 0;
+constexpr uint32_t const TIMER_CTRL_INTERRUPT_ENABLE = 1u << 3;
+
+void start_latency_timer(void)
+{
+	TIMER0->RELOAD = TimerReload;
+	TIMER0->VALUE = TimerReload;
+	TIMER0->CTRL = TIMER_CTRL_ENABLE | TIMER_CTRL_INTERRUPT_ENABLE;
+	NVIC_SetPriority(TIMER0_IRQn, 0); // Above the kernel priority (CoreInterrupt::KernelInterruptPriority), so the kernel never masks it
+	NVIC_EnableIRQ(TIMER0_IRQn);
+}
+
+extern "C" void TIMER0_IRQHandler(void)
+{
+	size_t latency = TimerReload - TIMER0->VALUE; // The timer is clocked by the core clock on the board
+	TIMER0->INTCLEAR = 1;
+
+	if (g_recording)
+	{
+		if (latency < g_statistics.min_irq_latency) {g_statistics.min_irq_latency = latency;}
+		if (latency > g_statistics.max_irq_latency) {g_statistics.max_irq_latency = latency;}
+	}
+}
+
+
+void record_wakeup(RTOS::TimeType expire_time)
+{
+	size_t cycle = DWT->CYCCNT;
+	if (!g_recording) {return;}
+
+	g_statistics.wakeups++;
+	if (RTOS::system_time() != expire_time)
+	{
+		g_statistics.late_wakeups++;
+	}
+	else
+	{
+		size_t lateness = cycle - g_tick_entry_cycle;
+		if (lateness > g_statistics.max_wakeup_lateness)
+		{
+			g_statistics.max_wakeup_lateness = lateness;
+		}
+	}
+}
+
+
+
+
+// Threads
+
+constexpr size_t const ThreadCounts[] = {10, 100, 1000};
+constexpr size_t const MaxThreadCount = 1000;
+constexpr size_t const Periods[] = {1, 2, 3, 5, 7, 11, 13, 17, 19, 23}; // In ticks
+constexpr size_t const PeriodCount = sizeof(Periods) / sizeof(Periods[0]);
+constexpr size_t const RunTime = 2000; // In ticks
+constexpr size_t const WorkerStackSize = 0x200;
+
+RTOS::Mutex g_held_mutex; // Owned by os_main during a run, so try_lock always times out
+RTOS::MessageQueue g_empty_queue; // Never written, so try_pull always times out
+bool volatile g_stop;
+std::atomic<size_t> g_finished_count; // Workers of the same priority preempt each other at ticks
+
+enum class WorkerKind : size_t
+{
+	Sleep,
+	MutexWait,
+	QueueWait,
+	Count,
+};
+
+size_t worker_procedure(size_t arg)
+{
+	WorkerKind kind = static_cast<WorkerKind>(arg % static_cast<size_t>(WorkerKind::Count));
+	size_t period = Periods[(arg / static_cast<size_t>(WorkerKind::Count)) % PeriodCount];
+
+	while (!g_stop)
+	{
+		RTOS::TimeType expire_time = RTOS::system_time() + period;
+		switch (kind)
+		{
+		case WorkerKind::Sleep:
+			RTOS::sleep(period);
+			break;
+		case WorkerKind::MutexWait:
+			g_held_mutex.try_lock(period);
+			break;
+		case WorkerKind::QueueWait:
+			g_empty_queue.try_pull(period);
+			break;
+		default:
+			break;
+		}
+		record_wakeup(expire_time);
+	}
+
+	g_finished_count++;
+	return 0;
+}
+
+
+RTOS::Thread g_workers[MaxThreadCount];
+
+
+void run(size_t thread_count)
+{
+	g_stop = false;
+	g_finished_count = 0;
+	g_held_mutex.lock();
+
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		g_workers[i].initialize(&worker_procedure, i, 1 + i % 8, WorkerStackSize);
+	}
+
+	RTOS::sleep(Periods[PeriodCount - 1]); // Let every worker block once before recording
+
+	g_statistics.max_tick_handler = 0;
+	g_statistics.min_irq_latency = ~0u;
+	g_statistics.max_irq_latency = 0;
+	g_statistics.max_wakeup_lateness = 0;
+	g_statistics.late_wakeups = 0;
+	g_statistics.wakeups = 0;
+	g_recording = true;
+
+	RTOS::sleep(RunTime);
+
+	g_recording = false;
+	g_stop = true;
+	while (g_finished_count < thread_count)
+	{
+		RTOS::sleep(Periods[PeriodCount - 1]);
+	}
+	RTOS::sleep(2); // Let the last workers terminate
+
+	g_held_mutex.unlock();
+	for (size_t i = 0; i < thread_count; i++)
+	{
+		g_workers[i].uninitialize();
+	}
+
+	char line[160];
+	char * end = line;
+	end = append_number(end, thread_count);
+	end = append_string(end, ",");
+	end = append_number(end, RunTime);
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.max_tick_handler);
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.min_irq_latency);
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.max_irq_latency);
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.max_wakeup_lateness);
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.late_wakeups.load());
+	end = append_string(end, ",");
+	end = append_number(end, g_statistics.wakeups.load());
+	end = append_string(end, "\n");
+	*end = '\0';
+	semihosting_write(line);
+}
+
+
+size_t os_main(size_t arg)
+{
+	g_empty_queue.initialize(1);
+	start_latency_timer();
+
+	semihosting_write("# RTOS scalability stress, unit: core cycles (ticks for run_ticks)\n");
+	semihosting_write("threads,run_ticks,max_tick_handler,min_irq_latency,max_irq_latency,max_wakeup_lateness,late_wakeups,wakeups\n");
+
+	for (size_t thread_count : ThreadCounts)
+	{
+		run(thread_count);
+	}
+
+	semihosting_exit(true);
+	return 0;
+}
+
+
+__attribute__((section("os_heap"), aligned(8))) char g_os_heap[0x100000]; // Holds the stacks of MaxThreadCount workers
+
+int main(void)
+{
+  RTOS::initialize(&os_main, 0x400, g_os_heap, sizeof(g_os_heap));
+}
@@ -10,6 +10,7 @@
 #include "./External/CMSIS/Device/ST/STM32F2xx/Include/stm32f207xx.h"
 #include "./External/MyLib/tx_assert.h"
 #include "stddef.h"
+#include <algorithm>
 
 
 class CoreClock
@@ -47,77 +48,201 @@ public:
 class CoreInterrupt
 {
 public:
-	static constexpr size_t const CoreCyclePerSystickCycle = 8;
-	static constexpr size_t const CoreCyclePerSystickCycleLog2 = 3; static_assert(1u << CoreCyclePerSystickCycleLog2 == CoreCyclePerSystickCycle);
+	static constexpr size_t const KernelInterruptPriority = 4; /* Most urgent NVIC priority level (0 being the most urgent) of the interrupts that may call the kernel
+	The kernel masks these levels with BASEPRI. Interrupts of levels 0 to KernelInterruptPriority - 1 are never delayed by the kernel and must not call it. */
+	static constexpr size_t const KernelBasepri = KernelInterruptPriority << (8u - __NVIC_PRIO_BITS);
+	static constexpr uint8_t const PendsvPriority = 0xFF; // Lowest priority because context switch cannot happen during interrupts
+	static constexpr uint8_t const TickTimerPriority = 0xFE; // SysTick, or the timer replacing it (see TickTimer)
+	static_assert(KernelInterruptPriority > 0 && KernelInterruptPriority < (1u << __NVIC_PRIO_BITS), "BASEPRI = 0 would disable the masking");
+	static_assert((TickTimerPriority & 0xFF & ~((1u << (8u - __NVIC_PRIO_BITS)) - 1u)) >= KernelBasepri, "The tick timer calls the kernel");
 
 public:
 
 	static void configure_priorities(void)
+	/* Every interrupt starts at the kernel level, so that it may call the kernel
+	 * Zero-latency interrupts are raised above the kernel afterwards, e.g. NVIC_SetPriority(TIM1_UP_IRQn, 0) */
 	{
 //		SCB->SHP[7] = 0xFE; // SVC; This interrupt is unused
-		SCB->SHP[10] = 0xFF; // PendSV; Set to lowest priority because context switch cannot happen during interrupts
-		SCB->SHP[11] = 0xFE; // SysTick
-	}
+		SCB->SHP[10] = PendsvPriority;
+		SCB->SHP[11] = TickTimerPriority;
 
-	static void configure_systick(void)
-	{
-		SysTick->CTRL = SysTick_CTRL_TICKINT_Msk;
+		size_t interrupt_count = ((SCnSCB->ICTR & SCnSCB_ICTR_INTLINESNUM_Msk) + 1u) * 32u;
+		interrupt_count = std::min(interrupt_count, sizeof(NVIC->IP)); // ICTR counts in blocks of 32 lines, up to 512, beyond the 240 lines of the NVIC
+		for (size_t i = 0; i < interrupt_count; i++)
+		{
+			NVIC->IP[i] = KernelBasepri;
+		}
 	}
 
 	static void initialize(void)
 	{
 		configure_priorities();
-		configure_systick();
 	}
 
-	static void enable_systick(void)
+	static void trigger_pendsv_interrupt(void)
 	{
-		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
 	}
 
-	static void disable_systick(void)
+public: // Kernel masking
+
+	static size_t mask_kernel_interrupts(void)
+	/* Mask the interrupts that may call the kernel and return the previous mask */
 	{
-		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		size_t basepri = __get_BASEPRI();
+		__set_BASEPRI_MAX(KernelBasepri); // Never lowers the mask
+		__ISB();
+		return basepri;
 	}
 
-	static void trigger_pendsv_interrupt(void)
+	static void unmask_kernel_interrupts(size_t basepri)
 	{
-		SCB->ICSR |= SCB_ICSR_PENDSVSET_Msk;
+		__set_BASEPRI(basepri);
 	}
 
-	static void trigger_systick_interrupt(void)
+	static bool is_in_handler_mode(void)
 	{
-		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+		return __get_IPSR() != 0;
 	}
 
-	static void clear_systick_interrupt(void)
+	static bool kernel_calls_are_allowed(void)
+	/* Whether the current context has a priority at which the kernel may be called */
 	{
-		SCB->ICSR |= SCB_ICSR_PENDSTCLR_Msk;
+		size_t exception = __get_IPSR();
+		if (exception == 0) {return true;} // Thread mode
+		if (exception < 4) {return false;} // NMI and HardFault are above any configurable priority
+		size_t priority = (exception < 16) ? SCB->SHP[exception - 4] : NVIC->IP[exception - 16];
+		return priority >= KernelBasepri;
+	}
+
+};
+
+
+class SystickTimer
+/* Tick timer of the kernel (see TickTimer in rtos_port.hpp); the 24-bit reload caps a countdown, hence a tickless sleep, at 2^27 core cycles */
+{
+public:
+	static constexpr size_t const CoreCyclePerTimerCycle = 8;
+	static constexpr size_t const CoreCyclePerTimerCycleLog2 = 3; static_assert(1u << CoreCyclePerTimerCycleLog2 == CoreCyclePerTimerCycle);
+
+public:
+
+	static void initialize(void)
+	{
+		SysTick->CTRL = SysTick_CTRL_TICKINT_Msk;
+	}
+
+	static void enable(void)
+	{
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	}
+
+	static void disable(void)
+	{
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	}
+
+	static void trigger_interrupt(void)
+	{
+		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
 	}
 
-	static void set_systick_countdown(size_t core_cycle)
+	static void clear_interrupt(void)
 	{
-		SysTick->LOAD = core_cycle >> CoreCyclePerSystickCycleLog2;
+		SCB->ICSR |= SCB_ICSR_PENDSTCLR_Msk;
 	}
 
+	static void acknowledge_interrupt(void) {} // Called first in the handler; SysTick clears its pending state on entry
+
 	static void reset_counter(size_t core_cycle)
+	/* Start a countdown of @core_cycle, which repeats until the next reset */
 	{
-		size_t systick_cycle = core_cycle >> CoreCyclePerSystickCycleLog2;
+		size_t systick_cycle = core_cycle >> CoreCyclePerTimerCycleLog2;
 		TX_ASSERT(systick_cycle > 1u && systick_cycle <= SysTick_LOAD_RELOAD_Msk);
 		SysTick->LOAD = systick_cycle - 1u;
 		SysTick->VAL = 0;
 	}
 
-	static constexpr size_t get_systick_max_countdown_in_core_cycle(void)
+	static constexpr size_t get_max_countdown_in_core_cycle(void)
+	{
+		return SysTick_LOAD_RELOAD_Msk << CoreCyclePerTimerCycleLog2;
+	}
+
+};
+
+
+class CoreMpu
+{
+public:
+	static constexpr size_t const StackGuardRegion = 0;
+	static constexpr size_t const StackGuardSizeLog2 = 5; // 32 bytes is the smallest region supported by the ARMv7-M MPU
+	static constexpr size_t const StackGuardSize = 1u << StackGuardSizeLog2;
+
+public:
+
+	static void initialize(size_t stack_begin)
+	/* Enable the MPU with a single no-access region guarding the bottom of the stack starting at @stack_begin
+	 * All other accesses follow the default memory map */
+	{
+		MPU->RNR = StackGuardRegion;
+		MPU->RBAR = get_stack_guard_begin(stack_begin);
+		MPU->RASR = ((StackGuardSizeLog2 - 1u) << MPU_RASR_SIZE_Pos) | MPU_RASR_XN_Msk | MPU_RASR_ENABLE_Msk; // Access permission 0b000: no access
+		MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+		SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk; // Report violations as MemManage faults rather than HardFaults
+		__DSB();
+		__ISB();
+	}
+
+	static constexpr size_t get_stack_guard_begin(size_t stack_begin)
+	{
+		return (stack_begin + StackGuardSize - 1u) & ~(StackGuardSize - 1u);
+	}
+
+	static constexpr size_t get_stack_guard_end(size_t stack_begin)
+	{
+		return get_stack_guard_begin(stack_begin) + StackGuardSize;
+	}
+
+	static size_t get_region_base_address_register_address(void)
+	{
+		return (size_t) &MPU->RBAR;
+	}
+
+	static constexpr size_t get_region_base_address_flags(void) // Flags to be written to MPU->RBAR along with the base address to select the guard region
+	{
+		return MPU_RBAR_VALID_Msk | StackGuardRegion;
+	}
+
+};
+
+
+class KernelSpinlock
+/* Single-core lock: mask the interrupts that may call the kernel (BASEPRI) and restore the previous mask on release */
+{
+private:
+	size_t m_basepri;
+
+public:
+	void acquire(void)
+	{
+		m_basepri = CoreInterrupt::mask_kernel_interrupts();
+	}
+
+	void release(void)
 	{
-		return SysTick_LOAD_RELOAD_Msk << CoreCyclePerSystickCycleLog2;
+		CoreInterrupt::unmask_kernel_interrupts(m_basepri);
 	}
 
 };
 
 
 class LowPowerState
+/* Sleep states of the idle governor (see SleepStates in rtos_port.hpp); the core alone only offers WFI with SLEEPDEEP cleared
+ * Latencies, residencies and resolutions are in core cycles. */
 {
+public:
+	static constexpr size_t const StateCount = 1;
+
 public:
 
 	static void initialize(void)
@@ -125,9 +250,31 @@ public:
 		SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
 	}
 
+	static char const * get_state_name(size_t state) {return "sleep";}
+	static constexpr size_t get_exit_latency(size_t state) {return 0;}
+	static constexpr size_t get_target_residency(size_t state) {return 0;} // Shortest idle period worth entering the state
+	static constexpr size_t get_wake_resolution(size_t state) {return 0;} // How much earlier than requested the state may end on its own
+	static constexpr size_t get_max_residency(size_t state) {return ~(size_t) 0;} // Longest time the state lasts before ending on its own
+	static constexpr bool can_enter(size_t state) {return true;} // Whether the state may be chosen at the moment
+
+	static size_t enter(size_t state, size_t core_cycle)
+	/* Sleep for at most @core_cycle; the tick timer is programmed to wake the core up
+	 * Return the core cycles during which the cycle counter was stopped, to be added to the time base. */
+	{
+		enter_sleep_mode();
+		return 0;
+	}
+
 	static void enter_sleep_mode(void)
+	/* Called with the kernel interrupts masked; they are still masked on return
+	 * BASEPRI is cleared around WFI because masked interrupts do not wake the core up, and PRIMASK keeps them pending meanwhile.
+	 * Zero-latency interrupts are only delayed by the wake-up itself. */
 	{
+		__disable_irq();
+		__set_BASEPRI(0);
 		__WFI();
+		__set_BASEPRI(CoreInterrupt::KernelBasepri);
+		__enable_irq();
 	}
 
 };
@@ -0,0 +1,38 @@
+/*
+ * cortexm4f_core.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "cortexm3_core.hpp" // The core peripherals used by the kernel are common to Cortex-M3 and Cortex-M4
+#include "stddef.h"
+
+
+class CoreFpu
+{
+private:
+	static constexpr size_t const CPACR_ADDRESS = 0xE000ED88; // Coprocessor access control register
+	static constexpr size_t const FPCCR_ADDRESS = 0xE000EF34; // Floating-point context control register
+
+	static constexpr size_t const CPACR_CP10_CP11_FULL_ACCESS = 0xFu << 20;
+	static constexpr size_t const FPCCR_ASPEN_Msk = 1u << 31; // Automatic state preservation on exception entry
+	static constexpr size_t const FPCCR_LSPEN_Msk = 1u << 30; // Lazy state preservation (s0-s15 are only written if the handler uses the FPU)
+
+public:
+	static constexpr size_t const ExcReturnThreadPsp = 0xFFFFFFFD; // Return to thread mode using psp, without floating-point context
+	static constexpr size_t const ExcReturnNoFpuContextMsk = 1u << 4; // Bit of EXC_RETURN; cleared if the exception frame contains a floating-point context
+
+public:
+
+	static void initialize(void)
+	{
+		*((size_t volatile *) CPACR_ADDRESS) |= CPACR_CP10_CP11_FULL_ACCESS;
+		*((size_t volatile *) FPCCR_ADDRESS) |= FPCCR_ASPEN_Msk | FPCCR_LSPEN_Msk;
+		__DSB();
+		__ISB();
+	}
+
+};
@@ -0,0 +1,421 @@
+/*
+ * posix_core.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+/* Core driver for running the kernel as a Linux user-space process (enabled by RTOS_PORT_POSIX)
+ * The process plays the role of a single core:
+ *   SysTick    -> SIGALRM raised by an interval timer (setitimer)
+ *   PRIMASK    -> SIGALRM blocked with sigprocmask, plus a flag
+ *   PendSV     -> a pending flag, serviced when interrupts are unmasked or when the SIGALRM handler returns
+ *   psp switch -> ucontext (swapcontext) stored at the top of each thread stack
+ *   DWT        -> clock_gettime(CLOCK_MONOTONIC) scaled to CoreClock::CycleFrequency
+ *   WFI        -> sigwait on SIGALRM (the signal is left pending, as WFI leaves the interrupt pending)
+ * The signal handler runs on the stack of the interrupted thread, so thread stacks need several KiB on this port.
+ */
+
+#include "./External/MyLib/tx_assert.h"
+#include <stddef.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <atomic>
+
+
+extern "C" void SysTick_Handler(void);
+extern "C" void PendSV_Handler(void);
+
+
+class CoreClock
+{
+public:
+	static constexpr size_t const CycleFrequency = 16000000; // Emulated core frequency; must match RTOSImpl::CoreFrequency
+
+private:
+	static size_t & get_origin(void)
+	{
+		static size_t s_origin = 0;
+		return s_origin;
+	}
+
+	static size_t get_monotonic_cycle(void)
+	{
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return (size_t) time.tv_sec * CycleFrequency + (size_t) time.tv_nsec * (CycleFrequency / 1000u) / 1000000u;
+	}
+
+public:
+	static void initialize(void)
+	{
+		get_origin() = get_monotonic_cycle(); // The counter starts from zero, as DWT->CYCCNT does
+	}
+
+	static size_t get_cycle_count(void)
+	{
+		return get_monotonic_cycle() - get_origin();
+	}
+
+	static bool clock_is_enabled(void)
+	{
+		return true;
+	}
+
+};
+
+
+
+
+
+class CoreInterrupt
+{
+	friend class SystickTimer;
+
+private:
+	struct State
+	{
+		sig_atomic_t volatile	primask;
+		sig_atomic_t volatile	pendsv_pending;
+		sig_atomic_t volatile	handler_mode; // Set while SysTick_Handler executes
+		bool									systick_enabled;
+		size_t								systick_period; // In core cycles
+	};
+
+	static State & get_state(void)
+	{
+		static State s_state;
+		return s_state;
+	}
+
+	static void block_systick_signal(void)
+	{
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, SIGALRM);
+		sigprocmask(SIG_BLOCK, &set, nullptr);
+	}
+
+	static void unblock_systick_signal(void)
+	{
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, SIGALRM);
+		sigprocmask(SIG_UNBLOCK, &set, nullptr);
+	}
+
+	static void arm_timer(size_t core_cycle)
+	{
+		size_t period_in_us = (core_cycle * 1000u) / (CoreClock::CycleFrequency / 1000u);
+		if (period_in_us == 0) {period_in_us = 1;}
+
+		itimerval timer;
+		timer.it_interval.tv_sec = period_in_us / 1000000u;
+		timer.it_interval.tv_usec = period_in_us % 1000000u;
+		timer.it_value = timer.it_interval;
+		setitimer(ITIMER_REAL, &timer, nullptr);
+	}
+
+	static void disarm_timer(void)
+	{
+		itimerval timer = {};
+		setitimer(ITIMER_REAL, &timer, nullptr);
+	}
+
+	static void systick_signal_handler(int)
+	{
+		State & state = get_state();
+		state.handler_mode = 1;
+		SysTick_Handler();
+		state.handler_mode = 0;
+		run_pending_pendsv(); // PendSV has the lowest priority and is tail-chained to SysTick
+	}
+
+	static void run_pending_pendsv(void)
+	/* Execute PendSV_Handler while it is pending; the systick signal must be blocked */
+	{
+		State & state = get_state();
+		while (state.pendsv_pending)
+		{
+			state.pendsv_pending = 0;
+			state.primask = 1;
+			PendSV_Handler(); // Returns once the outgoing thread is switched back in
+			state.primask = 0;
+		}
+	}
+
+public:
+
+	static void initialize(void)
+	{
+		struct sigaction action = {};
+		action.sa_handler = &systick_signal_handler;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGALRM, &action, nullptr);
+	}
+
+	static void trigger_pendsv_interrupt(void)
+	{
+		State & state = get_state();
+		state.pendsv_pending = 1;
+		if (!state.primask && !state.handler_mode) // Taken immediately, as on the target
+		{
+			disable_interrupts();
+			enable_interrupts();
+		}
+	}
+
+public: // Emulation of the PRIMASK register
+
+	static void disable_interrupts(void)
+	{
+		block_systick_signal();
+		get_state().primask = 1;
+	}
+
+	static void enable_interrupts(void)
+	{
+		State & state = get_state();
+		state.primask = 0;
+		if (state.handler_mode) {return;} // The handler unmasks the signal on return and chains PendSV itself
+		run_pending_pendsv();
+		unblock_systick_signal();
+	}
+
+	static bool interrupts_are_disabled(void)
+	{
+		return get_state().primask != 0;
+	}
+
+	static bool is_in_handler_mode(void)
+	{
+		return get_state().handler_mode != 0;
+	}
+
+public: // Kernel masking; the process has no interrupt above the kernel, so everything is masked
+
+	static size_t mask_kernel_interrupts(void)
+	{
+		if (interrupts_are_disabled()) {return 1;} // Spare the system call of nested sections
+		disable_interrupts();
+		return 0;
+	}
+
+	static void unmask_kernel_interrupts(size_t primask)
+	{
+		if (primask == 0)
+		{
+			enable_interrupts();
+		}
+	}
+
+	static bool kernel_calls_are_allowed(void)
+	{
+		return true;
+	}
+
+};
+
+
+class SystickTimer
+/* Tick timer of the kernel (see TickTimer in rtos_port.hpp), emulated with SIGALRM */
+{
+public:
+	static constexpr size_t const CoreCyclePerTimerCycle = 8;
+	static constexpr size_t const CoreCyclePerTimerCycleLog2 = 3; static_assert(1u << CoreCyclePerTimerCycleLog2 == CoreCyclePerTimerCycle);
+	static constexpr size_t const MaxCountdown = 0x00FFFFFF; // Same range as the 24-bit reload value of SysTick
+
+public:
+
+	static void initialize(void)
+	{
+		CoreInterrupt::get_state().systick_enabled = false;
+		CoreInterrupt::get_state().systick_period = 0;
+	}
+
+	static void enable(void)
+	{
+		CoreInterrupt::get_state().systick_enabled = true;
+		if (CoreInterrupt::get_state().systick_period != 0)
+		{
+			CoreInterrupt::arm_timer(CoreInterrupt::get_state().systick_period);
+		}
+	}
+
+	static void disable(void)
+	{
+		CoreInterrupt::get_state().systick_enabled = false;
+		CoreInterrupt::disarm_timer();
+	}
+
+	static void trigger_interrupt(void)
+	{
+		raise(SIGALRM); // Delivered as soon as the signal is unblocked
+	}
+
+	static void clear_interrupt(void)
+	{
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, SIGALRM);
+		timespec const no_wait = {0, 0};
+		while (sigtimedwait(&set, nullptr, &no_wait) == SIGALRM); // Consume the pending signal
+	}
+
+	static void acknowledge_interrupt(void) {}
+
+	static void reset_counter(size_t core_cycle)
+	{
+		if ((core_cycle >> CoreCyclePerTimerCycleLog2) <= 1u || (core_cycle >> CoreCyclePerTimerCycleLog2) > MaxCountdown)
+		{
+			core_cycle = 2u * CoreCyclePerTimerCycle; // The deadline has passed (the signal was late); fire as soon as possible
+		}
+		CoreInterrupt::get_state().systick_period = core_cycle;
+		if (CoreInterrupt::get_state().systick_enabled)
+		{
+			CoreInterrupt::arm_timer(core_cycle);
+		}
+	}
+
+	static constexpr size_t get_max_countdown_in_core_cycle(void)
+	{
+		return MaxCountdown << CoreCyclePerTimerCycleLog2;
+	}
+
+};
+
+
+class CoreMpu
+/* The process has no MPU; the constants are kept so that the kernel compiles unchanged (ThreadImpl::UseMpuStackGuard is false on this port) */
+{
+public:
+	static constexpr size_t const StackGuardRegion = 0;
+	static constexpr size_t const StackGuardSizeLog2 = 5;
+	static constexpr size_t const StackGuardSize = 1u << StackGuardSizeLog2;
+
+public:
+
+	static void initialize(size_t stack_begin) {}
+
+	static constexpr size_t get_stack_guard_begin(size_t stack_begin)
+	{
+		return (stack_begin + StackGuardSize - 1u) & ~(StackGuardSize - 1u);
+	}
+
+	static constexpr size_t get_stack_guard_end(size_t stack_begin)
+	{
+		return get_stack_guard_begin(stack_begin) + StackGuardSize;
+	}
+
+};
+
+
+class CoreContext
+{
+public:
+	static constexpr size_t const StackAlignment = 16; // Required by the x86-64 and AArch64 ABIs
+
+private:
+	template <void (*Entry)(void)>
+	static void start(void)
+	{
+		CoreInterrupt::enable_interrupts(); // The thread is entered from PendSV_Handler, as after the exception return on the target
+		Entry();
+	}
+
+public:
+
+	template <void (*Entry)(void)>
+	static void initialize(ucontext_t & context, size_t stack_begin, size_t stack_size)
+	{
+		getcontext(&context);
+		context.uc_stack.ss_sp = (void *) stack_begin;
+		context.uc_stack.ss_size = stack_size;
+		context.uc_link = nullptr;
+		sigemptyset(&context.uc_sigmask);
+		sigaddset(&context.uc_sigmask, SIGALRM);
+		makecontext(&context, &start<Entry>, 0);
+	}
+
+	static void switch_context(ucontext_t & context_out, ucontext_t & context_in)
+	{
+		swapcontext(&context_out, &context_in);
+	}
+
+};
+
+
+class LowPowerState
+/* Sleep states of the idle governor (see SleepStates in rtos_port.hpp); the process only waits for the signal */
+{
+public:
+	static constexpr size_t const StateCount = 1;
+
+public:
+
+	static void initialize(void) {}
+
+	static char const * get_state_name(size_t state) {return "sleep";}
+	static constexpr size_t get_exit_latency(size_t state) {return 0;}
+	static constexpr size_t get_target_residency(size_t state) {return 0;}
+	static constexpr size_t get_wake_resolution(size_t state) {return 0;}
+	static constexpr size_t get_max_residency(size_t state) {return ~(size_t) 0;}
+	static constexpr bool can_enter(size_t state) {return true;}
+
+	static size_t enter(size_t state, size_t core_cycle)
+	{
+		enter_sleep_mode();
+		return 0;
+	}
+
+	static void enter_sleep_mode(void)
+	{
+		TX_ASSERT(CoreInterrupt::interrupts_are_disabled()); // Otherwise the signal would be consumed here instead of by the handler
+
+		sigset_t set;
+		sigemptyset(&set);
+		sigaddset(&set, SIGALRM);
+		int signal_number;
+		sigwait(&set, &signal_number);
+		raise(SIGALRM); // Leave the interrupt pending
+	}
+
+};
+
+
+class KernelSpinlock
+/* Single-core lock: mask interrupts for the duration of the critical section and restore the previous mask on release */
+{
+private:
+	size_t m_primask;
+
+public:
+	void acquire(void)
+	{
+		m_primask = CoreInterrupt::mask_kernel_interrupts();
+	}
+
+	void release(void)
+	{
+		CoreInterrupt::unmask_kernel_interrupts(m_primask);
+	}
+
+};
+
+
+
+
+// Equivalents of the CMSIS intrinsics used by the kernel
+
+inline void __disable_irq(void) {CoreInterrupt::disable_interrupts();}
+inline void __enable_irq(void) {CoreInterrupt::enable_interrupts();}
+inline size_t __get_PRIMASK(void) {return CoreInterrupt::interrupts_are_disabled() ? 1u : 0u;}
+inline size_t __get_CONTROL(void) {return CoreInterrupt::is_in_handler_mode() ? 0u : 0b10u;} // SPSEL is set in thread mode
+inline void __DMB(void) {std::atomic_signal_fence(std::memory_order_seq_cst);}
+inline void __DSB(void) {std::atomic_signal_fence(std::memory_order_seq_cst);}
+inline void __ISB(void) {std::atomic_signal_fence(std::memory_order_seq_cst);}
+inline void __NOP(void) {__asm volatile("nop");}
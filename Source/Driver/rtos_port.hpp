@@ -0,0 +1,60 @@
+/*
+ * rtos_port.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+/* Select the core driver the kernel is built against
+ *   default:          Cortex-M3 (Cortex-M4F additionally uses cortexm4f_core.hpp when __ARM_FP is defined)
+ *   RTOS_PORT_POSIX:  Linux user-space process (see posix_core.hpp)
+ * Each driver provides CoreClock, CoreInterrupt, CoreMpu, LowPowerState and the lock type KernelSpinlock.
+ * CoreInterrupt::mask_kernel_interrupts masks the interrupts that may call the kernel (BASEPRI on Cortex-M, everything on POSIX).
+ *
+ * Select the tick timer, which raises the kernel's timer interrupt (ticks, precise expirations and the end of tickless sleeps)
+ *   default:               SysTick (SIGALRM on POSIX); its 24-bit reload caps a tickless sleep at about 8 s at 16 MHz
+ *   RTOS_TICK_TIMER_TIM2:  TIM2 of STM32F2, 32 bits (see stm32f2_tim2_timer.hpp); a tickless sleep lasts up to 2^31 core cycles
+ * TickTimer provides initialize, enable, disable, trigger_interrupt, clear_interrupt, acknowledge_interrupt, reset_counter and get_max_countdown_in_core_cycle.
+ *
+ * Select the sleep states among which the idle governor chooses (see IdleGovernor)
+ *   default:               LowPowerState, i.e. WFI only
+ *   RTOS_LOW_POWER_STOP:   the stop modes of STM32F2, woken up by the RTC (see stm32f2_stop_mode.hpp)
+ * SleepStates provides StateCount, initialize, get_state_name, get_exit_latency, get_target_residency, get_wake_resolution, get_max_residency, can_enter and enter.
+ */
+
+#if defined(RTOS_PORT_POSIX)
+
+	#include "./Source/Driver/posix_core.hpp"
+
+	#if defined(RTOS_TICK_TIMER_TIM2)
+		#error "The POSIX port has no TIM2"
+	#endif
+
+	#if defined(RTOS_LOW_POWER_STOP)
+		#error "The POSIX port has no stop mode"
+	#endif
+
+	typedef SystickTimer TickTimer;
+	typedef LowPowerState SleepStates;
+
+#else
+
+	#include "./Source/Driver/cortexm3_core.hpp"
+
+	#if defined(RTOS_TICK_TIMER_TIM2)
+		#include "./Source/Driver/stm32f2_tim2_timer.hpp"
+		typedef Tim2Timer TickTimer;
+	#else
+		typedef SystickTimer TickTimer;
+	#endif
+
+	#if defined(RTOS_LOW_POWER_STOP)
+		#include "./Source/Driver/stm32f2_stop_mode.hpp"
+		typedef Stm32f2StopMode SleepStates;
+	#else
+		typedef LowPowerState SleepStates;
+	#endif
+
+#endif
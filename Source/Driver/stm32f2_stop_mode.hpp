@@ -0,0 +1,182 @@
+/*
+ * stm32f2_stop_mode.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "cortexm3_core.hpp"
+#include "./External/MyLib/tx_assert.h"
+#include "stddef.h"
+#include "stdint.h"
+
+
+class Stm32f2StopMode
+/* Sleep states of STM32F2 for the idle governor (enabled by RTOS_LOW_POWER_STOP, see SleepStates in rtos_port.hpp)
+ *   0 sleep:    WFI; the tick timer wakes the core up
+ *   1 stop:     SLEEPDEEP with the main regulator on; every clock of the 1.2 V domain stops, including the cycle counter and the tick timer
+ *   2 stop_lp:  as stop, with the regulator in low-power mode and the flash powered down; slower to exit, lower consumption
+ * A stop state is ended by the wakeup timer of the RTC, clocked by LSE / 2 (16384 Hz), and returns the time spent stopped to the kernel.
+ * That time is the wakeup period plus the typical restart time of the regulator and HSI; since the divider of the wakeup timer is free-running,
+ *  the period is exact to one period of its clock (61 us).
+ * The counter of the wakeup timer cannot be read, and the RTC of STM32F2 has no sub-second register, so an earlier wake-up would leave the time unknown:
+ *  the stop states are not entered while any other EXTI line is unmasked, as an interrupt or an event.
+ * An interrupt already pending would end WFI at once, before the clocks stop; enter then only sleeps, and reports that the cycle counter kept running.
+ * The core resumes from stop on HSI, which is the clock the kernel is built for; an application running on the PLL must not enable the stop states.
+ * initialize waits for LSE to start, which may take up to 2 s; the RTC is left running and its calendar is not modified.
+ */
+{
+public:
+	static constexpr size_t const StateCount = 3;
+	static constexpr size_t const CoreFrequency = 16000000; // HSI; must match RTOSImpl::CoreFrequency
+	static constexpr size_t const WakeupFrequencyLog2 = 14; // LSE (32768 Hz) / 2
+	static constexpr size_t const MaxWakeupCount = 0x10000; // Range of the 16-bit wakeup timer, i.e. 4 s
+
+private:
+	static constexpr uint32_t const RtcKey1 = 0xCA; // Written to RTC->WPR to unlock the RTC registers
+	static constexpr uint32_t const RtcKey2 = 0x53;
+	static constexpr uint32_t const RtcFlagMsk = 0xFFFF; // The flags of RTC->ISR are cleared by writing 0, and left unchanged by writing 1
+
+	static void unlock_rtc(void)
+	{
+		RTC->WPR = RtcKey1;
+		RTC->WPR = RtcKey2;
+	}
+
+	static void lock_rtc(void)
+	{
+		RTC->WPR = 0xFF;
+	}
+
+	static bool other_wakeup_line_is_enabled(void)
+	{
+		return ((EXTI->IMR & ~EXTI_IMR_MR22) | (EXTI->EMR & ~EXTI_EMR_MR22)) != 0;
+	}
+
+	static bool interrupt_is_pending(void)
+	// Pending interrupts end WFI even while masked
+	{
+		if (SCB->ICSR & (SCB_ICSR_PENDSTSET_Msk | SCB_ICSR_PENDSVSET_Msk)) {return true;}
+		for (size_t i = 0; i < sizeof(NVIC->ISPR) / sizeof(NVIC->ISPR[0]); i++)
+		{
+			if (NVIC->ISPR[i] != 0) {return true;}
+		}
+		return false;
+	}
+
+	static void stop_wakeup_timer(void)
+	// The RTC registers must be unlocked
+	{
+		RTC->CR &= ~RTC_CR_WUTE;
+		while (!(RTC->ISR & RTC_ISR_WUTWF)); // Within 2 RTCCLK cycles
+		RTC->ISR = RtcFlagMsk & ~(RTC_ISR_WUTF | RTC_ISR_INIT);
+		EXTI->PR = EXTI_PR_PR22;
+	}
+
+public:
+
+	static void initialize(void)
+	{
+		LowPowerState::initialize();
+
+		RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+		__DSB();
+		PWR->CR |= PWR_CR_DBP; // Write access to the backup domain
+
+		RCC->BDCR |= RCC_BDCR_LSEON;
+		while (!(RCC->BDCR & RCC_BDCR_LSERDY));
+		TX_ASSERT((RCC->BDCR & RCC_BDCR_RTCSEL) == 0 || (RCC->BDCR & RCC_BDCR_RTCSEL) == RCC_BDCR_RTCSEL_0); // Another RTC clock can only be changed by a backup domain reset
+		RCC->BDCR |= RCC_BDCR_RTCSEL_0 | RCC_BDCR_RTCEN;
+
+		unlock_rtc();
+		stop_wakeup_timer();
+		RTC->CR = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUCKSEL_1 | RTC_CR_WUCKSEL_0 | RTC_CR_WUTIE; // RTCCLK / 2
+		lock_rtc();
+
+		EXTI->IMR |= EXTI_IMR_MR22; // The wakeup timer is on EXTI line 22
+		EXTI->RTSR |= EXTI_RTSR_TR22;
+		NVIC_ClearPendingIRQ((IRQn_Type) RTC_WKUP_IRQn);
+		NVIC_EnableIRQ((IRQn_Type) RTC_WKUP_IRQn); // Only to wake the core up; the kernel clears it before it is taken, so it needs no handler
+	}
+
+	static char const * get_state_name(size_t state)
+	{
+		return state == 0 ? "sleep" : state == 1 ? "stop" : "stop_lp";
+	}
+
+	static constexpr size_t get_restart_time(size_t state)
+	// Typical wake-up times from the datasheet, during which the regulator and HSI restart and the cycle counter is still stopped
+	{
+		return state == 0 ? 0 : state == 1 ? 17u * (CoreFrequency / 1000000u) : 110u * (CoreFrequency / 1000000u);
+	}
+
+	static constexpr size_t get_exit_latency(size_t state)
+	// Restart time plus margin
+	{
+		return state == 0 ? 0 : state == 1 ? 20u * (CoreFrequency / 1000000u) : 130u * (CoreFrequency / 1000000u);
+	}
+
+	static constexpr size_t get_target_residency(size_t state)
+	// Beyond the exit latency, entering a stop state costs up to two RTCCLK cycles of synchronization each way
+	{
+		return state == 0 ? 0 : state == 1 ? 2u * (CoreFrequency / 1000u) : 10u * (CoreFrequency / 1000u);
+	}
+
+	static constexpr size_t get_wake_resolution(size_t state)
+	// The count is rounded down, and its first period is shortened by the phase of the divider
+	{
+		return state == 0 ? 0 : 2u * ((CoreFrequency >> WakeupFrequencyLog2) + 1u);
+	}
+
+	static constexpr size_t get_max_residency(size_t state)
+	// A longer idle period is slept in several entries
+	{
+		return state == 0 ? ~(size_t) 0 : (size_t) (((uint64_t) MaxWakeupCount * CoreFrequency) >> WakeupFrequencyLog2);
+	}
+
+	static bool can_enter(size_t state)
+	{
+		return state == 0 || !other_wakeup_line_is_enabled();
+	}
+
+	static size_t enter(size_t state, size_t core_cycle)
+	/* Sleep for at most @core_cycle
+	 * Return the core cycles during which the cycle counter was stopped, to be added to the time base. */
+	{
+		size_t wakeup_count = (size_t) (((uint64_t) core_cycle << WakeupFrequencyLog2) / CoreFrequency);
+		__disable_irq(); // An interrupt may have unmasked another EXTI line since the state was chosen, but none can after this check
+		if (state == 0 || wakeup_count < 2u || other_wakeup_line_is_enabled() || interrupt_is_pending())
+		{
+			__enable_irq();
+			LowPowerState::enter_sleep_mode();
+			return 0;
+		}
+		if (wakeup_count > MaxWakeupCount) {wakeup_count = MaxWakeupCount;}
+
+		unlock_rtc();
+		RTC->WUTR = wakeup_count - 1u;
+		RTC->CR |= RTC_CR_WUTE;
+		lock_rtc();
+
+		PWR->CR = (PWR->CR & ~(PWR_CR_PDDS | PWR_CR_LPDS | PWR_CR_FPDS)) | (state == 2 ? PWR_CR_LPDS | PWR_CR_FPDS : 0);
+		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+		__set_BASEPRI(0);
+		__WFI();
+		__set_BASEPRI(CoreInterrupt::KernelBasepri);
+
+		SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+		bool timed_out = RTC->ISR & RTC_ISR_WUTF; // Otherwise an interrupt raised since the check ended WFI before the clocks stopped
+		unlock_rtc();
+		stop_wakeup_timer();
+		lock_rtc();
+		NVIC_ClearPendingIRQ((IRQn_Type) RTC_WKUP_IRQn);
+		__enable_irq();
+
+		if (!timed_out) {return 0;}
+		return (size_t) (((uint64_t) wakeup_count * CoreFrequency) >> WakeupFrequencyLog2) + get_restart_time(state);
+	}
+
+};
@@ -0,0 +1,98 @@
+/*
+ * stm32f2_tim2_timer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "cortexm3_core.hpp"
+#include "./External/MyLib/tx_assert.h"
+#include "stddef.h"
+
+
+class Tim2Timer
+/* Tick timer of the kernel on the 32-bit general-purpose timer TIM2 of STM32F2 (enabled by RTOS_TICK_TIMER_TIM2, see TickTimer in rtos_port.hpp)
+ * The counter counts up to ARR and raises an update interrupt on overflow. Its prescaler is set so that it counts every CoreCyclePerTimerCycle core cycles,
+ *  assuming the AHB prescaler is 1 (HCLK is the core clock); the timer clock is PCLK1, doubled by the hardware when the APB1 prescaler is not 1.
+ * A countdown is only capped by the 32-bit cycle counter the kernel extends on each interrupt (see SystemTimer), which must not wrap in between.
+ */
+{
+public:
+	static constexpr size_t const CoreCyclePerTimerCycle = 8;
+	static constexpr size_t const CoreCyclePerTimerCycleLog2 = 3; static_assert(1u << CoreCyclePerTimerCycleLog2 == CoreCyclePerTimerCycle);
+	static constexpr size_t const MaxCountdownInCoreCycle = (size_t) 1 << 31; // Half the wrap period of DWT->CYCCNT, leaving margin for a late interrupt
+
+public:
+
+	static void initialize(void)
+	{
+		RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+		__DSB(); // The peripheral clock is enabled two AHB cycles after the write
+
+		TIM2->CR1 = 0; // Up-counting, no preload of ARR, so that reset_counter takes effect immediately
+		TIM2->PSC = get_prescaler();
+		TIM2->ARR = MaxCountdownInCoreCycle >> CoreCyclePerTimerCycleLog2;
+		TIM2->EGR = TIM_EGR_UG; // Load the prescaler
+		TIM2->SR = 0;
+		TIM2->DIER = TIM_DIER_UIE;
+
+		NVIC->IP[TIM2_IRQn] = CoreInterrupt::TickTimerPriority;
+		NVIC_ClearPendingIRQ((IRQn_Type) TIM2_IRQn);
+		NVIC_EnableIRQ((IRQn_Type) TIM2_IRQn);
+	}
+
+	static void enable(void)
+	{
+		TIM2->CR1 |= TIM_CR1_CEN;
+	}
+
+	static void disable(void)
+	{
+		TIM2->CR1 &= ~TIM_CR1_CEN;
+	}
+
+	static void trigger_interrupt(void)
+	{
+		NVIC_SetPendingIRQ((IRQn_Type) TIM2_IRQn);
+	}
+
+	static void clear_interrupt(void)
+	{
+		TIM2->SR = ~TIM_SR_UIF;
+		__DSB(); // Otherwise the interrupt may be pended again by the flag being cleared
+		NVIC_ClearPendingIRQ((IRQn_Type) TIM2_IRQn);
+	}
+
+	static void acknowledge_interrupt(void)
+	{
+		TIM2->SR = ~TIM_SR_UIF; // The flag bits are cleared by writing 0; writing 1 has no effect
+		__DSB();
+	}
+
+	static void reset_counter(size_t core_cycle)
+	/* Start a countdown of @core_cycle, which repeats until the next reset */
+	{
+		size_t timer_cycle = core_cycle >> CoreCyclePerTimerCycleLog2;
+		TX_ASSERT(timer_cycle > 1u && timer_cycle <= (MaxCountdownInCoreCycle >> CoreCyclePerTimerCycleLog2));
+		TIM2->ARR = timer_cycle - 1u;
+		TIM2->CNT = 0;
+	}
+
+	static constexpr size_t get_max_countdown_in_core_cycle(void)
+	{
+		return MaxCountdownInCoreCycle;
+	}
+
+private:
+
+	static size_t get_prescaler(void)
+	{
+		size_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos; // 0b0xx: not divided, 0b100 to 0b111: divided by 2 to 16
+		size_t timer_clock_divider_log2 = (ppre1 & 0b100u) ? (ppre1 & 0b011u) : 0; // The doubling cancels one division
+		TX_ASSERT(timer_clock_divider_log2 <= CoreCyclePerTimerCycleLog2);
+		return (CoreCyclePerTimerCycle >> timer_clock_divider_log2) - 1u;
+	}
+
+};
@@ -0,0 +1,58 @@
+/*
+ * rtos_allocator.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "rtos_allocator_tlsf.hpp"
+#include "./External/MyLib/tx_memory_halffit.hpp"
+#include <stddef.h>
+
+
+namespace RTOS
+{
+
+
+class AllocatorHalfFitMeasured : public AllocatorHalfFit
+// AllocatorHalfFit does not expose its free lists, so its largest free block is measured through alloc
+{
+public:
+
+	template <typename Lock>
+	size_t get_largest_free_size(Lock & lock)
+	/* Binary search of the largest size alloc accepts, with one alloc/free pair per step
+	 * For a good-fit allocator this is the largest block alloc can return, which may be smaller than the largest free block.
+	 * @lock (lock_acquire, lock_release) is taken for each step only, so the search holds it for one allocation at a time; the result is then a snapshot of no single instant. */
+	{
+		lock.lock_acquire();
+		size_t fitting_size = 0;
+		size_t failing_size = get_unused_size() + 1u;
+		lock.lock_release();
+
+		while (failing_size - fitting_size > 1u)
+		{
+			size_t size = fitting_size + (failing_size - fitting_size) / 2u;
+			lock.lock_acquire();
+			void * mem_ptr = alloc(size);
+			if (mem_ptr != nullptr)
+			{
+				free(mem_ptr);
+				fitting_size = size;
+			}
+			else
+			{
+				failing_size = size;
+			}
+			lock.lock_release();
+		}
+		return fitting_size;
+	}
+
+};
+
+
+
+} // namespace RTOS
@@ -0,0 +1,219 @@
+/*
+ * rtos_allocator_tlsf.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#include "rtos_allocator_tlsf.hpp"
+#include "./External/MyLib/tx_assert.h"
+
+
+namespace RTOS
+{
+
+
+
+
+void AllocatorTlsf::initialize(void * mem_ptr, size_t mem_size)
+{
+	size_t begin = ((size_t) mem_ptr + Alignment - 1u) & ~(Alignment - 1u);
+	size_t end = ((size_t) mem_ptr + mem_size) & ~(Alignment - 1u);
+	TX_ASSERT(end > begin + 2u * HeaderSize + MinPayloadSize);
+
+	m_first_level_bitmap = 0;
+	for (size_t i = 0; i < FirstLevelCount; i++)
+	{
+		m_second_level_bitmaps[i] = 0;
+		for (size_t j = 0; j < SecondLevelCount; j++)
+		{
+			m_free_lists[i][j] = nullptr;
+		}
+	}
+
+	// One free block spanning the heap, followed by a used block of size 0 that stops the merges
+	m_first_block = reinterpret_cast<Block *>(begin);
+	m_first_block->m_prev_physical = nullptr;
+	m_first_block->m_size = end - begin - 2u * HeaderSize;
+	m_total_size = m_first_block->m_size;
+	m_free_size = 0;
+
+	Block & sentinel = get_next_physical(*m_first_block);
+	sentinel.m_prev_physical = m_first_block;
+	sentinel.m_size = 0;
+
+	insert_free_block(*m_first_block);
+}
+
+void * AllocatorTlsf::alloc(size_t size)
+{
+	if (size > m_total_size) {return nullptr;} // Before the rounding, which wraps for sizes close to SIZE_MAX; m_total_size is aligned
+	size = (size + Alignment - 1u) & ~(Alignment - 1u);
+	if (size < MinPayloadSize) {size = MinPayloadSize;}
+
+	Block * block = find_free_block(size);
+	if (block == nullptr) {return nullptr;}
+
+	remove_free_block(*block);
+	split(*block, size);
+	block->m_size &= ~FreeFlag;
+	return reinterpret_cast<char *>(block) + HeaderSize;
+}
+
+void AllocatorTlsf::free(void * mem_ptr)
+{
+	if (mem_ptr == nullptr) {return;}
+
+	Block * block = &get_block_from_payload(mem_ptr);
+	TX_ASSERT(!is_free(*block)); // Failing means a double free
+
+	Block & next = get_next_physical(*block);
+	if (is_free(next))
+	{
+		remove_free_block(next);
+		merge_with_next(*block);
+	}
+
+	Block * prev = block->m_prev_physical;
+	if (prev != nullptr && is_free(*prev))
+	{
+		remove_free_block(*prev);
+		block = &merge_with_next(*prev);
+	}
+
+	insert_free_block(*block);
+}
+
+size_t AllocatorTlsf::get_largest_free_size(void) const
+{
+	if (m_first_level_bitmap == 0) {return 0;}
+
+	size_t first_level = get_msb(m_first_level_bitmap);
+	size_t second_level = 31u - __builtin_clz(m_second_level_bitmaps[first_level]);
+
+	size_t largest_size = 0;
+	for (Block const * block = m_free_lists[first_level][second_level]; block != nullptr; block = block->m_next_free)
+	{
+		if (get_payload_size(*block) > largest_size)
+		{
+			largest_size = get_payload_size(*block);
+		}
+	}
+	return largest_size;
+}
+
+
+
+
+void AllocatorTlsf::insert_free_block(Block & block)
+{
+	size_t first_level, second_level;
+	get_list_index(get_payload_size(block), first_level, second_level);
+
+	Block * head = m_free_lists[first_level][second_level];
+	block.m_size |= FreeFlag;
+	block.m_prev_free = nullptr;
+	block.m_next_free = head;
+	if (head != nullptr)
+	{
+		head->m_prev_free = &block;
+	}
+	m_free_lists[first_level][second_level] = &block;
+
+	m_first_level_bitmap |= (size_t) 1 << first_level;
+	m_second_level_bitmaps[first_level] |= (uint32_t) 1 << second_level;
+	m_free_size += get_payload_size(block);
+}
+
+void AllocatorTlsf::remove_free_block(Block & block)
+{
+	size_t first_level, second_level;
+	get_list_index(get_payload_size(block), first_level, second_level);
+
+	if (block.m_prev_free != nullptr)
+	{
+		block.m_prev_free->m_next_free = block.m_next_free;
+	}
+	else
+	{
+		m_free_lists[first_level][second_level] = block.m_next_free;
+		if (block.m_next_free == nullptr)
+		{
+			m_second_level_bitmaps[first_level] &= ~((uint32_t) 1 << second_level);
+			if (m_second_level_bitmaps[first_level] == 0)
+			{
+				m_first_level_bitmap &= ~((size_t) 1 << first_level);
+			}
+		}
+	}
+	if (block.m_next_free != nullptr)
+	{
+		block.m_next_free->m_prev_free = block.m_prev_free;
+	}
+
+	m_free_size -= get_payload_size(block);
+}
+
+AllocatorTlsf::Block * AllocatorTlsf::find_free_block(size_t size)
+// Good fit: start from the first list whose blocks are all at least @size, so that the head of any list found fits
+{
+	size_t requested_size = size;
+	if (size >= (1u << FirstLevelShift))
+	{
+		size += ((size_t) 1 << (get_msb(size) - SecondLevelCountLog2)) - 1u;
+	}
+
+	size_t first_level, second_level;
+	get_list_index(size, first_level, second_level);
+	if (first_level >= FirstLevelCount) {return nullptr;}
+
+	uint32_t second_level_map = m_second_level_bitmaps[first_level] & (~(uint32_t) 0 << second_level);
+	if (second_level_map == 0)
+	{
+		size_t first_level_map = (first_level + 1u < FirstLevelCount) ? m_first_level_bitmap & (~(size_t) 0 << (first_level + 1u)) : 0;
+		if (first_level_map == 0)
+		{
+			// Last resort: the head of the list holding @size itself, which may still fit (e.g. the whole heap in one block)
+			get_list_index(requested_size, first_level, second_level);
+			Block * block = m_free_lists[first_level][second_level];
+			return (block != nullptr && get_payload_size(*block) >= requested_size) ? block : nullptr;
+		}
+
+		first_level = __builtin_ctzl(first_level_map);
+		second_level_map = m_second_level_bitmaps[first_level];
+	}
+	second_level = __builtin_ctz(second_level_map);
+
+	return m_free_lists[first_level][second_level];
+}
+
+void AllocatorTlsf::split(Block & block, size_t size)
+// Give the tail of @block beyond @size back to the free lists, if it can hold a block of its own
+{
+	size_t payload_size = get_payload_size(block);
+	if (payload_size < size + HeaderSize + MinPayloadSize) {return;}
+
+	Block & next = get_next_physical(block);
+	block.m_size = size | (block.m_size & FreeFlag);
+
+	Block & remainder = get_next_physical(block);
+	remainder.m_prev_physical = &block;
+	remainder.m_size = payload_size - size - HeaderSize;
+	next.m_prev_physical = &remainder;
+
+	insert_free_block(remainder);
+}
+
+AllocatorTlsf::Block & AllocatorTlsf::merge_with_next(Block & block)
+// The next block must have been removed from the free lists
+{
+	Block & next = get_next_physical(block);
+	block.m_size += HeaderSize + get_payload_size(next);
+	get_next_physical(block).m_prev_physical = &block;
+	return block;
+}
+
+
+
+
+} // namespace RTOS
@@ -0,0 +1,117 @@
+/*
+ * rtos_allocator_tlsf.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace RTOS
+{
+
+
+class AllocatorTlsf
+/* Two-level segregated fit allocator: alloc and free take a bounded number of steps, independent of the heap content
+ * Free blocks are kept in lists indexed by (first level = log2 of the size, second level = SecondLevelCount subdivisions of it),
+ *  with a bitmap per level, so the smallest list that certainly fits a request is found with two bit scans.
+ * Each block has a header holding its size and the address of the previous physical block, so that free blocks coalesce immediately.
+ * Like AllocatorHalfFit, the allocator is not locked; see RTOS::alloc.
+ */
+{
+public:
+	static constexpr size_t const Alignment = 8;
+	static constexpr size_t const AlignmentLog2 = 3; static_assert(1u << AlignmentLog2 == Alignment);
+	static constexpr size_t const SecondLevelCountLog2 = 4;
+	static constexpr size_t const SecondLevelCount = 1u << SecondLevelCountLog2;
+	static constexpr size_t const FirstLevelShift = SecondLevelCountLog2 + AlignmentLog2; // Sizes below 1 << FirstLevelShift are split linearly by Alignment
+	static constexpr size_t const FirstLevelCount = sizeof(size_t) * 8u - FirstLevelShift + 1u;
+
+
+private:
+	struct Block
+	{
+		Block *							m_prev_physical;	// Null for the first block
+		size_t							m_size;						// Payload size; bit 0 is set if the block is free
+		Block *							m_next_free;			// Only valid in free blocks (these overlap the payload)
+		Block *							m_prev_free;
+	};
+
+	static constexpr size_t const FreeFlag = 1;
+	static constexpr size_t const HeaderSize = __builtin_offsetof(Block, m_next_free); static_assert(HeaderSize % Alignment == 0);
+	static constexpr size_t const MinPayloadSize = sizeof(Block) - HeaderSize;
+
+
+private:
+	size_t								m_first_level_bitmap;
+	uint32_t							m_second_level_bitmaps[FirstLevelCount]; static_assert(SecondLevelCount <= 32);
+	Block *								m_free_lists[FirstLevelCount][SecondLevelCount];
+	Block *								m_first_block;
+	size_t								m_total_size;	// Payload of the whole heap once merged into one block
+	size_t								m_free_size;	// Sum of the payloads of the free blocks
+
+
+public:
+	AllocatorTlsf(void) noexcept = default;
+	AllocatorTlsf(AllocatorTlsf const &) noexcept = delete;
+	AllocatorTlsf(AllocatorTlsf &&) noexcept = delete;
+	~AllocatorTlsf(void) noexcept = default;
+	void operator=(AllocatorTlsf const &) noexcept = delete;
+	void operator=(AllocatorTlsf &&) noexcept = delete;
+
+	void initialize(void * mem_ptr, size_t mem_size);
+	void * alloc(size_t size); // Return nullptr if no free block fits
+	void free(void * mem_ptr);
+
+	size_t get_used_size(void) const {return m_total_size - m_free_size;} // Including the block headers
+	size_t get_unused_size(void) const {return m_free_size;}
+	size_t get_largest_free_size(void) const; // Payload of the largest free block, found in the highest non-empty list
+
+
+private:
+	static size_t get_msb(size_t value)
+	{
+		return sizeof(size_t) * 8u - 1u - __builtin_clzl(value);
+	}
+
+	static void get_list_index(size_t size, size_t & first_level, size_t & second_level)
+	{
+		if (size < (1u << FirstLevelShift))
+		{
+			first_level = 0;
+			second_level = size >> AlignmentLog2;
+		}
+		else
+		{
+			size_t msb = get_msb(size);
+			first_level = msb - FirstLevelShift + 1u;
+			second_level = (size >> (msb - SecondLevelCountLog2)) ^ SecondLevelCount;
+		}
+	}
+
+	static size_t get_payload_size(Block const & block) {return block.m_size & ~FreeFlag;}
+	static bool is_free(Block const & block) {return (block.m_size & FreeFlag) != 0;}
+	static Block & get_next_physical(Block & block)
+	{
+		return *reinterpret_cast<Block *>(reinterpret_cast<char *>(&block) + HeaderSize + get_payload_size(block));
+	}
+	static Block & get_block_from_payload(void * mem_ptr)
+	{
+		return *reinterpret_cast<Block *>(static_cast<char *>(mem_ptr) - HeaderSize);
+	}
+
+	void insert_free_block(Block & block);
+	void remove_free_block(Block & block);
+	Block * find_free_block(size_t size);
+	void split(Block & block, size_t size);
+	Block & merge_with_next(Block & block);
+
+};
+
+
+
+} // namespace RTOS
@@ -0,0 +1,84 @@
+/*
+ * rtos_config.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+/* Compile-time configuration of the kernel
+ * Each setting is 1 (enabled) by default, except RTOS_CONFIG_HEAP_PROFILER, and can be overridden from the build, e.g. -DRTOS_CONFIG_TRACE=0 (see kernel_configurations in meson.build).
+ * A disabled feature is compiled out entirely: its hooks expand to nothing, and its public functions remain as stubs that report nothing.
+ *
+ *   RTOS_CONFIG_PROFILER           Per-section statistics of the kernel operations (see Profiler)
+ *   RTOS_CONFIG_HEAP_PROFILER      Per-tag statistics of RTOS::alloc (see HeapProfiler); off by default, since it masks the kernel interrupts on every
+ *                                   RTOS::alloc and RTOS::free, cached ones included, and adds a record to the header of each block
+ *   RTOS_CONFIG_TRACE              Ring buffer of scheduler events (see Trace)
+ *   RTOS_CONFIG_CRITICAL_SECTION   Durations of the critical sections (see CriticalSectionMonitor)
+ *   RTOS_CONFIG_CPU_ACCOUNTING     Core cycles credited to each thread on context switches and ticks; without it, the cpu usage report,
+ *                                   the system load and Thread::get_cpu_cycles only count the cycles the idle thread spent in a stop state
+ *   RTOS_CONFIG_SLEEP_LIST         Expirations of sleep() in the ExpirationList (1) or in the SleepHeap (0)
+ *   RTOS_CONFIG_SOFT_BLOCK_LIST    Expirations of try_lock, try_pull and try_alloc in the ExpirationList (1) or in the ExpireHeap (0);
+ *                                   the _until_cycles variants always use the precise expiration list
+ * Only the expiration structures selected by the last two settings are built.
+ * The assertions are removed by TX_NO_ASSERT, as for the RTOS_no_assert library.
+ */
+
+
+#ifndef RTOS_CONFIG_PROFILER
+	#define RTOS_CONFIG_PROFILER 1
+#endif
+
+#ifndef RTOS_CONFIG_HEAP_PROFILER
+	#define RTOS_CONFIG_HEAP_PROFILER 0
+#endif
+
+#ifndef RTOS_CONFIG_TRACE
+	#define RTOS_CONFIG_TRACE 1
+#endif
+
+#ifndef RTOS_CONFIG_CRITICAL_SECTION
+	#define RTOS_CONFIG_CRITICAL_SECTION 1
+#endif
+
+#ifndef RTOS_CONFIG_CPU_ACCOUNTING
+	#define RTOS_CONFIG_CPU_ACCOUNTING 1
+#endif
+
+#ifndef RTOS_CONFIG_SLEEP_LIST
+	#define RTOS_CONFIG_SLEEP_LIST 1
+#endif
+
+#ifndef RTOS_CONFIG_SOFT_BLOCK_LIST
+	#define RTOS_CONFIG_SOFT_BLOCK_LIST 1
+#endif
+
+#define RTOS_CONFIG_EXPIRATION_LIST (RTOS_CONFIG_SLEEP_LIST || RTOS_CONFIG_SOFT_BLOCK_LIST)
+
+
+
+#if defined(RTOS_PROFILER_ENABLE) || defined(RTOS_HEAP_PROFILER_ENABLE) || defined(RTOS_TRACE_ENABLE) \
+		|| defined(RTOS_CRITICAL_SECTION_ENABLE) || defined(RTOS_CPU_ACCOUNTING_ENABLE) // Guard against duplicated directives
+	#error "Select the features with the RTOS_CONFIG_ settings"
+#endif
+
+#if RTOS_CONFIG_PROFILER
+	#define RTOS_PROFILER_ENABLE
+#endif
+
+#if RTOS_CONFIG_HEAP_PROFILER
+	#define RTOS_HEAP_PROFILER_ENABLE
+#endif
+
+#if RTOS_CONFIG_TRACE
+	#define RTOS_TRACE_ENABLE
+#endif
+
+#if RTOS_CONFIG_CRITICAL_SECTION
+	#define RTOS_CRITICAL_SECTION_ENABLE
+#endif
+
+#if RTOS_CONFIG_CPU_ACCOUNTING
+	#define RTOS_CPU_ACCOUNTING_ENABLE
+#endif
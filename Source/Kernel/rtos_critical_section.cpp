@@ -0,0 +1,63 @@
+/*
+ * rtos_critical_section.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+
+#include "rtos_critical_section.hpp"
+#include <string.h>
+
+
+
+
+namespace RTOS
+{
+
+
+#ifdef RTOS_CRITICAL_SECTION_ENABLE
+
+size_t CriticalSectionMonitor::s_depth = 0;
+void const * CriticalSectionMonitor::s_site;
+size_t CriticalSectionMonitor::s_time_start;
+CriticalSectionStatistics CriticalSectionMonitor::s_statistics;
+
+void get_critical_section_statistics(CriticalSectionStatistics & statistics)
+{
+	size_t state = CoreInterrupt::mask_kernel_interrupts();
+	RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+	memcpy(&statistics, &CriticalSectionMonitor::s_statistics, __builtin_offsetof(CriticalSectionStatistics, sites));
+	RTOS_CRITICAL_SECTION_EXIT();
+	CoreInterrupt::unmask_kernel_interrupts(state);
+
+	for (size_t i = 0; i < CriticalSectionSiteCount; i++)
+	{
+		state = CoreInterrupt::mask_kernel_interrupts();
+		RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+		statistics.sites[i] = CriticalSectionMonitor::s_statistics.sites[i];
+		RTOS_CRITICAL_SECTION_EXIT();
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+}
+
+void reset_critical_section_statistics(void)
+{
+	size_t state = CoreInterrupt::mask_kernel_interrupts();
+	memset(&CriticalSectionMonitor::s_statistics, 0, sizeof(CriticalSectionMonitor::s_statistics));
+	CoreInterrupt::unmask_kernel_interrupts(state);
+}
+
+#else
+
+void get_critical_section_statistics(CriticalSectionStatistics & statistics)
+{
+	memset(&statistics, 0, sizeof(statistics));
+}
+
+void reset_critical_section_statistics(void) {}
+
+#endif
+
+
+} // namespace RTOS
@@ -0,0 +1,129 @@
+/*
+ * rtos_critical_section.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "./Source/Driver/rtos_port.hpp"
+#include "rtos_config.hpp"
+#include "./Source/PublicApi/rtos.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef RTOS_CRITICAL_SECTION_ENABLE
+
+	#define RTOS_CRITICAL_SECTION_ENTER(site)			CriticalSectionMonitor::enter(site)
+	#define RTOS_CRITICAL_SECTION_EXIT()					CriticalSectionMonitor::exit()
+	#define RTOS_CRITICAL_SECTION_HERE()					CriticalSectionMonitor::get_program_counter()
+
+#else
+
+	#define RTOS_CRITICAL_SECTION_ENTER(site)
+	#define RTOS_CRITICAL_SECTION_EXIT()
+	#define RTOS_CRITICAL_SECTION_HERE()					nullptr
+
+#endif
+
+
+
+namespace RTOS
+{
+
+
+class CriticalSectionMonitor
+/* Durations of the kernel critical sections, i.e. the intervals during which the kernel interrupts are masked
+ * Every call must be made with interrupts masked: enter right after masking, exit right before unmasking.
+ * Sections may nest (e.g. the scheduler lock taken inside sleep_procedure); only the outermost one is measured.
+ * Each section is attributed to the code address where it was entered, in a small open-addressing table of sites.
+ */
+{
+public:
+	static constexpr size_t const SiteCount = CriticalSectionSiteCount; static_assert((SiteCount & (SiteCount - 1u)) == 0, "The site table is indexed with a mask");
+
+
+public:
+	static size_t											s_depth;
+	static void const *								s_site;
+	static size_t											s_time_start;
+	static CriticalSectionStatistics	s_statistics;
+
+
+private:
+
+	static size_t get_histogram_index(size_t duration)
+	{
+		if (duration == 0) {return 0;}
+		size_t index = sizeof(size_t) * 8u - 1u - __builtin_clzl(duration);
+		return index < ProfileHistogramSize ? index : ProfileHistogramSize - 1u;
+	}
+
+	static size_t get_site_index(void const * site)
+	{
+		size_t address = reinterpret_cast<size_t>(site);
+		return ((address >> 1) ^ (address >> 5)) & (SiteCount - 1u);
+	}
+
+	static void record(void const * site, size_t duration)
+	{
+		s_statistics.count++;
+		s_statistics.total_cycles += duration;
+		s_statistics.histogram[get_histogram_index(duration)]++;
+		if (duration > s_statistics.max_cycles)
+		{
+			s_statistics.max_cycles = duration;
+			s_statistics.max_site = site;
+		}
+
+		size_t index = get_site_index(site);
+		for (size_t probe = 0; probe < SiteCount; probe++)
+		{
+			CriticalSectionSite & entry = s_statistics.sites[index];
+			if (entry.site == site || entry.site == nullptr)
+			{
+				entry.site = site;
+				entry.count++;
+				entry.total_cycles += duration;
+				if (duration > entry.max_cycles) {entry.max_cycles = duration;}
+				return;
+			}
+			index = (index + 1u) & (SiteCount - 1u);
+		}
+		s_statistics.untracked_count++; // The table is full
+	}
+
+
+public:
+
+	__attribute__((noinline)) static void const * get_program_counter(void)
+	{
+		return __builtin_return_address(0);
+	}
+
+	static void enter(void const * site)
+	{
+		if (s_depth++ == 0)
+		{
+			s_site = site;
+			s_time_start = CoreClock::get_cycle_count();
+		}
+	}
+
+	static void exit(void)
+	{
+		TX_ASSERT(s_depth > 0);
+
+		if (--s_depth == 0)
+		{
+			record(s_site, CoreClock::get_cycle_count() - s_time_start);
+		}
+	}
+
+};
+
+
+
+} // namespace RTOS
@@ -0,0 +1,94 @@
+/*
+ * rtos_heap_profiler.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+
+#include "rtos_heap_profiler.hpp"
+#include "rtos_impl.hpp"
+#include <string.h>
+
+
+
+
+namespace RTOS
+{
+
+
+#ifdef RTOS_HEAP_PROFILER_ENABLE
+
+HeapRecord * HeapProfiler::s_head = nullptr;
+HeapRecord * HeapProfiler::s_tail = nullptr;
+HeapStatistics HeapProfiler::s_statistics;
+
+void get_heap_statistics(HeapStatistics & statistics)
+{
+	size_t state = CoreInterrupt::mask_kernel_interrupts();
+	RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+	memcpy(&statistics, &HeapProfiler::s_statistics, __builtin_offsetof(HeapStatistics, owners));
+	RTOS_CRITICAL_SECTION_EXIT();
+	CoreInterrupt::unmask_kernel_interrupts(state);
+
+	for (size_t i = 0; i < HeapOwnerCount; i++)
+	{
+		state = CoreInterrupt::mask_kernel_interrupts();
+		RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+		statistics.owners[i] = HeapProfiler::s_statistics.owners[i];
+		RTOS_CRITICAL_SECTION_EXIT();
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+}
+
+void reset_heap_peaks(void)
+{
+	size_t state = CoreInterrupt::mask_kernel_interrupts();
+	HeapStatistics & statistics = HeapProfiler::s_statistics;
+	statistics.peak_size = statistics.live_size;
+	statistics.peak_used_size = used_memory();
+	for (HeapOwner & owner : statistics.owners)
+	{
+		owner.peak_size = owner.live_size;
+	}
+	CoreInterrupt::unmask_kernel_interrupts(state);
+}
+
+size_t get_heap_blocks(HeapBlock * report, size_t capacity, size_t min_serial)
+{
+	size_t count = 0;
+
+	size_t state = CoreInterrupt::mask_kernel_interrupts();
+	RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+	for (HeapRecord const * record = HeapProfiler::s_tail; record != nullptr && count < capacity && record->m_serial >= min_serial; record = record->m_prev)
+	{
+		report[count].mem_ptr = RTOSImpl::get_mem_ptr_from_m_record(*record);
+		report[count].size = record->m_size;
+		report[count].tag = record->m_tag;
+		report[count].serial = record->m_serial;
+		count++;
+	}
+	RTOS_CRITICAL_SECTION_EXIT();
+	CoreInterrupt::unmask_kernel_interrupts(state);
+
+	return count;
+}
+
+#else
+
+void get_heap_statistics(HeapStatistics & statistics)
+{
+	memset(&statistics, 0, sizeof(statistics));
+}
+
+void reset_heap_peaks(void) {}
+
+size_t get_heap_blocks(HeapBlock * report, size_t capacity, size_t min_serial)
+{
+	return 0;
+}
+
+#endif
+
+
+} // namespace RTOS
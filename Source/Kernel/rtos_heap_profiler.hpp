@@ -0,0 +1,180 @@
+/*
+ * rtos_heap_profiler.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "rtos_critical_section.hpp"
+#include "./Source/Driver/rtos_port.hpp"
+#include "rtos_config.hpp"
+#include "./Source/PublicApi/rtos.hpp"
+#include "./External/MyLib/tx_assert.h"
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef RTOS_HEAP_PROFILER_ENABLE
+
+	#define RTOS_HEAP_PROFILER_ALLOC(record, size, tag)		HeapProfiler::on_alloc(record, size, tag)
+	#define RTOS_HEAP_PROFILER_FREE(record)								HeapProfiler::on_free(record)
+	#define RTOS_HEAP_PROFILER_FAIL()											HeapProfiler::on_fail()
+	#define RTOS_HEAP_PROFILER_RESERVE(used_size)					HeapProfiler::on_reserve(used_size)
+
+#else
+
+	#define RTOS_HEAP_PROFILER_ALLOC(record, size, tag)
+	#define RTOS_HEAP_PROFILER_FREE(record)
+	#define RTOS_HEAP_PROFILER_FAIL()
+	#define RTOS_HEAP_PROFILER_RESERVE(used_size)
+
+#endif
+
+
+
+namespace RTOS
+{
+
+
+struct HeapRecord // Part of the header of each live block of RTOS::alloc (see RTOSImpl::AllocHeader)
+{
+	HeapRecord *									m_next;		// Live blocks, in increasing serial order
+	HeapRecord *									m_prev;
+	size_t												m_size;		// Requested size
+	size_t												m_tag;
+	size_t												m_serial;
+};
+
+
+class HeapProfiler
+/* Accounting of the live blocks of RTOS::alloc, per tag (see set_heap_tag) and in total
+ * The live blocks are linked in allocation order, so that the newest ones, i.e. the leak candidates, are reached first from the tail.
+ * The tags are kept in a small open-addressing table, like the critical section sites; a tag is never removed from it.
+ * Each update masks the kernel interrupts on its own, since the cached path of RTOS::alloc does not take the kernel lock.
+ */
+{
+public:
+	static constexpr size_t const OwnerCount = HeapOwnerCount; static_assert((OwnerCount & (OwnerCount - 1u)) == 0, "The owner table is indexed with a mask");
+
+
+public:
+	static HeapRecord *								s_head;
+	static HeapRecord *								s_tail;
+	static HeapStatistics							s_statistics;
+
+
+private:
+
+	static size_t get_histogram_index(size_t size)
+	{
+		if (size == 0) {return 0;}
+		size_t index = sizeof(size_t) * 8u - 1u - __builtin_clzl(size);
+		return index < HeapHistogramSize ? index : HeapHistogramSize - 1u;
+	}
+
+	static size_t get_owner_index(size_t tag)
+	{
+		return ((tag >> 3) ^ (tag >> 7)) & (OwnerCount - 1u);
+	}
+
+	static HeapOwner * find_owner(size_t tag, bool insert)
+	// Return nullptr if @tag is not in the table and cannot be inserted
+	{
+		size_t index = get_owner_index(tag);
+		for (size_t probe = 0; probe < OwnerCount; probe++)
+		{
+			HeapOwner & entry = s_statistics.owners[index];
+			if (entry.alloc_count == 0) // Unused entry, since an entry counts at least the allocation that inserted it
+			{
+				if (!insert) {return nullptr;}
+				entry.tag = tag;
+				return &entry;
+			}
+			if (entry.tag == tag) {return &entry;}
+			index = (index + 1u) & (OwnerCount - 1u);
+		}
+		return nullptr;
+	}
+
+
+public:
+
+	static void on_alloc(HeapRecord & record, size_t size, size_t tag)
+	{
+		size_t state = CoreInterrupt::mask_kernel_interrupts();
+		RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+
+		record.m_size = size;
+		record.m_tag = tag;
+		record.m_serial = s_statistics.serial++;
+		record.m_next = nullptr;
+		record.m_prev = s_tail;
+		if (s_tail != nullptr) {s_tail->m_next = &record;} else {s_head = &record;}
+		s_tail = &record;
+
+		s_statistics.alloc_count++;
+		s_statistics.live_count++;
+		s_statistics.live_size += size;
+		if (s_statistics.live_size > s_statistics.peak_size) {s_statistics.peak_size = s_statistics.live_size;}
+		s_statistics.histogram[get_histogram_index(size)]++;
+
+		HeapOwner * owner = find_owner(tag, true);
+		if (owner != nullptr)
+		{
+			owner->alloc_count++;
+			owner->live_count++;
+			owner->live_size += size;
+			if (owner->live_size > owner->peak_size) {owner->peak_size = owner->live_size;}
+		}
+		else
+		{
+			s_statistics.untracked_count++; // The table is full
+		}
+
+		RTOS_CRITICAL_SECTION_EXIT();
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+
+	static void on_free(HeapRecord & record)
+	{
+		size_t state = CoreInterrupt::mask_kernel_interrupts();
+		RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+
+		if (record.m_prev != nullptr) {record.m_prev->m_next = record.m_next;} else {s_head = record.m_next;}
+		if (record.m_next != nullptr) {record.m_next->m_prev = record.m_prev;} else {s_tail = record.m_prev;}
+
+		TX_ASSERT(s_statistics.live_count > 0);
+		s_statistics.live_count--;
+		s_statistics.live_size -= record.m_size;
+
+		HeapOwner * owner = find_owner(record.m_tag, false); // Absent if the table was already full when the block was allocated
+		if (owner != nullptr)
+		{
+			owner->live_count--;
+			owner->live_size -= record.m_size;
+		}
+
+		RTOS_CRITICAL_SECTION_EXIT();
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+
+	static void on_fail(void)
+	{
+		size_t state = CoreInterrupt::mask_kernel_interrupts();
+		s_statistics.failed_count++;
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+
+	static void on_reserve(size_t used_size)
+	// The caller holds the kernel lock, right after taking memory from the heap allocator
+	{
+		if (used_size > s_statistics.peak_used_size) {s_statistics.peak_used_size = used_size;}
+	}
+
+};
+
+
+
+} // namespace RTOS
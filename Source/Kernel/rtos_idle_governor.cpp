@@ -0,0 +1,134 @@
+/*
+ * rtos_idle_governor.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+
+#include "rtos_idle_governor.hpp"
+#include "rtos_impl.hpp"
+
+
+
+
+namespace RTOS
+{
+
+
+size_t IdleGovernor::s_constraints[WakeLatencyConstraintCount];
+size_t IdleGovernor::s_max_wake_latency;
+IdleStateStatistics IdleGovernor::s_statistics[IdleGovernor::StateCount];
+
+extern RTOSImpl g_rtos;
+static Scheduler & g_scheduler = g_rtos.m_scheduler;
+
+
+
+
+void IdleGovernor::initialize(void)
+{
+	for (size_t & constraint : s_constraints)
+	{
+		constraint = NoConstraint;
+	}
+	s_max_wake_latency = NoConstraint;
+	reset();
+}
+
+void IdleGovernor::record(size_t state, size_t planned_core_cycle, size_t residency_core_cycle)
+/* @planned_core_cycle is the time the state was asked to last; the wake-up is premature if it came earlier than the resolution of the state allows */
+{
+	IdleStateStatistics & statistics = s_statistics[state];
+	statistics.entry_count++;
+	statistics.residency_cycles += residency_core_cycle;
+
+	if (residency_core_cycle + SleepStates::get_wake_resolution(state) + RTOSImpl::TickTolerance < planned_core_cycle)
+	{
+		statistics.premature_count++;
+		return;
+	}
+
+	size_t latency = residency_core_cycle > planned_core_cycle ? residency_core_cycle - planned_core_cycle : 0;
+	statistics.total_wake_latency_cycles += latency;
+	if (latency > statistics.max_wake_latency_cycles) {statistics.max_wake_latency_cycles = latency;}
+}
+
+size_t IdleGovernor::add_constraint(size_t max_latency_core_cycle)
+{
+	for (size_t i = 0; i < WakeLatencyConstraintCount; i++)
+	{
+		if (s_constraints[i] == NoConstraint)
+		{
+			s_constraints[i] = max_latency_core_cycle;
+			if (max_latency_core_cycle < s_max_wake_latency) {s_max_wake_latency = max_latency_core_cycle;}
+			return i + 1u;
+		}
+	}
+	return 0;
+}
+
+void IdleGovernor::remove_constraint(size_t handle)
+{
+	TX_ASSERT(handle > 0 && handle <= WakeLatencyConstraintCount && s_constraints[handle - 1u] != NoConstraint);
+	s_constraints[handle - 1u] = NoConstraint;
+
+	s_max_wake_latency = NoConstraint;
+	for (size_t constraint : s_constraints)
+	{
+		if (constraint < s_max_wake_latency) {s_max_wake_latency = constraint;}
+	}
+}
+
+void IdleGovernor::reset(void)
+{
+	for (size_t state = 0; state < StateCount; state++)
+	{
+		IdleStateStatistics & statistics = s_statistics[state];
+		statistics = IdleStateStatistics();
+		statistics.name = SleepStates::get_state_name(state);
+		statistics.exit_latency_cycles = SleepStates::get_exit_latency(state);
+		statistics.target_residency_cycles = SleepStates::get_target_residency(state);
+	}
+}
+
+
+
+
+size_t add_wake_latency_constraint(size_t max_latency_us)
+{
+	size_t max_latency_core_cycle = (max_latency_us < IdleGovernor::NoConstraint / RTOSImpl::CoreCyclePerMicrosecond) ? max_latency_us * RTOSImpl::CoreCyclePerMicrosecond : IdleGovernor::NoConstraint - 1u;
+
+	g_scheduler.lock_acquire();
+	size_t handle = IdleGovernor::add_constraint(max_latency_core_cycle);
+	g_scheduler.lock_release();
+	return handle;
+}
+
+void remove_wake_latency_constraint(size_t handle)
+{
+	g_scheduler.lock_acquire();
+	IdleGovernor::remove_constraint(handle);
+	g_scheduler.lock_release();
+}
+
+size_t get_idle_statistics(IdleStateStatistics * report, size_t capacity)
+{
+	for (size_t i = 0; i < capacity && i < IdleGovernor::StateCount; i++)
+	{
+		g_scheduler.lock_acquire();
+		IdleGovernor::read(i, report[i]);
+		g_scheduler.lock_release();
+	}
+	return IdleGovernor::StateCount;
+}
+
+void reset_idle_statistics(void)
+{
+	g_scheduler.lock_acquire();
+	IdleGovernor::reset();
+	g_scheduler.lock_release();
+}
+
+
+} // namespace RTOS
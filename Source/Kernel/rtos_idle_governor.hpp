@@ -0,0 +1,63 @@
+/*
+ * rtos_idle_governor.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "./Source/Driver/rtos_port.hpp"
+#include "./Source/PublicApi/rtos.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+
+namespace RTOS
+{
+
+
+class IdleGovernor
+/* Choice of the sleep state of the idle thread (see Scheduler::sleep_procedure), among the SleepStates of the port
+ * The deepest state is chosen that the port allows, whose target residency fits in the idle period and whose exit latency meets every wake latency constraint.
+ * The caller holds the kernel lock, as do the public operations, which are short.
+ */
+{
+public:
+	static constexpr size_t const StateCount = SleepStates::StateCount;
+	static constexpr size_t const NoConstraint = ~(size_t) 0; // Marks a free entry of s_constraints
+
+
+private:
+	static size_t													s_constraints[WakeLatencyConstraintCount];	// In core cycles
+	static size_t													s_max_wake_latency;	// Smallest of s_constraints
+	static IdleStateStatistics						s_statistics[StateCount];
+
+
+public:
+
+	static void initialize(void);
+
+	static size_t select_state(size_t idle_core_cycle)
+	{
+		size_t state = StateCount - 1u;
+		while (state > 0 && (SleepStates::get_target_residency(state) > idle_core_cycle || SleepStates::get_exit_latency(state) > s_max_wake_latency
+				|| !SleepStates::can_enter(state)))
+		{
+			state--;
+		}
+		return state;
+	}
+
+	static void record(size_t state, size_t planned_core_cycle, size_t residency_core_cycle);
+
+	static size_t add_constraint(size_t max_latency_core_cycle);
+	static void remove_constraint(size_t handle);
+	static void read(size_t state, IdleStateStatistics & statistics) {statistics = s_statistics[state];}
+	static void reset(void);
+
+};
+
+
+
+} // namespace RTOS
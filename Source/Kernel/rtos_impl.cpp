@@ -9,9 +9,9 @@
 
 #include "rtos_impl.hpp"
 #include "rtos_profiler.hpp"
-#include "./Source/Driver/cortexm3_core.hpp"
+#include "rtos_trace.hpp"
+#include "./Source/Driver/rtos_port.hpp"
 #include "./External/MyLib/tx_assert.h"
-#include "./External/CMSIS/Include/cmsis_compiler.h"
 
 
 
@@ -21,6 +21,10 @@ namespace RTOS
 
 RTOSImpl g_rtos;
 
+#if defined(RTOS_PORT_POSIX)
+	static_assert(CoreClock::CycleFrequency == RTOSImpl::CoreFrequency, "The emulated core frequency must match the kernel configuration");
+#endif
+
 
 
 
@@ -28,6 +32,7 @@ void RTOSImpl::initialize(FunctionPtr entry, size_t stack_size, void * mem_ptr,
 {
 	CoreClock::initialize();
 	RTOS_PROFILER_INIT(& CoreClock::get_cycle_count);
+	RTOS_TRACE_INIT(CoreFrequency);
 
 	m_system_timer.initialize();
 	m_mem_allocator.initialize(mem_ptr, mem_size);
@@ -43,14 +48,163 @@ void initialize(FunctionPtr entry, size_t stack_size, void * mem_ptr, size_t mem
 	g_rtos.initialize(entry, stack_size, mem_ptr, mem_size);
 }
 
+ThreadImpl * RTOSImpl::get_allocating_thread(void)
+// Thread executing, or nullptr if there is none with a cache (handler mode, idle thread, before the scheduler starts)
+{
+	if (CoreInterrupt::is_in_handler_mode()) {return nullptr;}
+
+	ThreadImpl * thread = m_scheduler.m_core.m_thread_on_core;
+	if (thread == nullptr || thread == &m_scheduler.m_core.m_idle_thread) {return nullptr;}
+	return thread;
+}
+
+void * RTOSImpl::alloc_locked(size_t size)
+{
+	m_scheduler.lock_acquire();
+	void * block = m_mem_allocator.alloc(size);
+	RTOS_HEAP_PROFILER_RESERVE(m_mem_allocator.get_used_size());
+	m_scheduler.lock_release();
+	return block;
+}
+
+void RTOSImpl::free_locked(void * block)
+{
+	m_scheduler.lock_acquire();
+	m_mem_allocator.free(block);
+	m_scheduler.lock_release();
+}
+
+void * RTOSImpl::alloc(size_t size)
+/* Small blocks come from the cache of the calling thread, which only that thread touches, so the common case takes no lock
+ * An empty cache is refilled with a batch of blocks (see get_alloc_cache_batch) under a single kernel lock, which bounds the time the lock is held. */
+{
+	if (size > ~(size_t) 0 - AllocHeaderSize) // The size with its header would wrap
+	{
+		RTOS_HEAP_PROFILER_FAIL();
+		return nullptr;
+	}
+
+	size_t size_class = get_alloc_class(size);
+	ThreadImpl * thread = get_allocating_thread();
+	AllocCache * cache = (size_class < AllocLargeClass && thread != nullptr) ? &thread->m_alloc_cache : nullptr;
+	char * block;
+
+	if (cache != nullptr)
+	{
+		if (cache->m_counts[size_class] == 0)
+		{
+			size_t batch = get_alloc_cache_batch(size_class);
+			m_scheduler.lock_acquire();
+			for (size_t i = 0; i < batch; i++)
+			{
+				void * refill_block = m_mem_allocator.alloc(AllocHeaderSize + get_alloc_class_size(size_class));
+				if (refill_block == nullptr) {break;}
+				*static_cast<void **>(refill_block) = cache->m_blocks[size_class];
+				cache->m_blocks[size_class] = refill_block;
+				cache->m_counts[size_class]++;
+			}
+			RTOS_HEAP_PROFILER_RESERVE(m_mem_allocator.get_used_size());
+			m_scheduler.lock_release();
+
+			if (cache->m_counts[size_class] == 0)
+			{
+				RTOS_HEAP_PROFILER_FAIL();
+				return nullptr;
+			}
+		}
+
+		block = static_cast<char *>(cache->m_blocks[size_class]);
+		cache->m_blocks[size_class] = *reinterpret_cast<void **>(block);
+		cache->m_counts[size_class]--;
+	}
+	else
+	{
+		size_t block_size = (size_class < AllocLargeClass) ? get_alloc_class_size(size_class) : size; // Small blocks may be freed into a cache later
+		block = static_cast<char *>(alloc_locked(AllocHeaderSize + block_size));
+		if (block == nullptr)
+		{
+			RTOS_HEAP_PROFILER_FAIL();
+			return nullptr;
+		}
+	}
+
+	AllocHeader & header = *reinterpret_cast<AllocHeader *>(block);
+	header.m_size_class = size_class;
+	RTOS_HEAP_PROFILER_ALLOC(header.m_record, size, (thread != nullptr) ? thread->m_heap_tag : 0);
+	return block + AllocHeaderSize;
+}
+
+void RTOSImpl::free(void * mem_ptr)
+// A full cache first spills a batch of blocks under a single kernel lock
+{
+	if (mem_ptr == nullptr) {return;}
+
+	char * block = static_cast<char *>(mem_ptr) - AllocHeaderSize;
+	AllocHeader & header = *reinterpret_cast<AllocHeader *>(block);
+	size_t size_class = header.m_size_class;
+	TX_ASSERT(size_class <= AllocLargeClass); // Failing means that the block was not allocated by RTOS::alloc
+	RTOS_HEAP_PROFILER_FREE(header.m_record);
+
+	ThreadImpl * thread = (size_class < AllocLargeClass) ? get_allocating_thread() : nullptr;
+	AllocCache * cache = (thread != nullptr) ? &thread->m_alloc_cache : nullptr;
+
+	if (cache != nullptr)
+	{
+		if (cache->m_counts[size_class] == get_alloc_cache_depth(size_class))
+		{
+			size_t batch = get_alloc_cache_batch(size_class);
+			m_scheduler.lock_acquire();
+			for (size_t i = 0; i < batch; i++)
+			{
+				void * spill_block = cache->m_blocks[size_class];
+				cache->m_blocks[size_class] = *static_cast<void **>(spill_block);
+				m_mem_allocator.free(spill_block);
+			}
+			cache->m_counts[size_class] -= batch;
+			m_scheduler.lock_release();
+		}
+
+		*reinterpret_cast<void **>(block) = cache->m_blocks[size_class];
+		cache->m_blocks[size_class] = block;
+		cache->m_counts[size_class]++;
+	}
+	else
+	{
+		free_locked(block);
+	}
+}
+
+void RTOSImpl::release_alloc_cache(ThreadImpl & thread)
+// Return the cached blocks of a thread that will not run again; the lock is taken once per class
+{
+	AllocCache & cache = thread.m_alloc_cache;
+	for (size_t size_class = 0; size_class < AllocCache::ClassCount; size_class++)
+	{
+		m_scheduler.lock_acquire();
+		void * block = cache.m_blocks[size_class];
+		while (block != nullptr)
+		{
+			void * next_block = *static_cast<void **>(block);
+			m_mem_allocator.free(block);
+			block = next_block;
+		}
+		cache.m_blocks[size_class] = nullptr;
+		cache.m_counts[size_class] = 0;
+		m_scheduler.lock_release();
+	}
+}
+
+
+
+
 void * alloc(size_t size)
 {
-	return g_rtos.m_mem_allocator.alloc(size);
+	return g_rtos.alloc(size);
 }
 
 void free(void * mem_ptr)
 {
-	g_rtos.m_mem_allocator.free(mem_ptr);
+	g_rtos.free(mem_ptr);
 }
 
 size_t used_memory(void)
@@ -63,6 +217,31 @@ size_t unused_memory(void)
 	return g_rtos.m_mem_allocator.get_unused_size();
 }
 
+static inline size_t measure_largest_free_size(AllocatorTlsf & allocator)
+{
+	g_rtos.m_scheduler.lock_acquire();
+	size_t largest_free_size = allocator.get_largest_free_size();
+	g_rtos.m_scheduler.lock_release();
+	return largest_free_size;
+}
+
+static inline size_t measure_largest_free_size(AllocatorHalfFitMeasured & allocator)
+{
+	return allocator.get_largest_free_size(g_rtos.m_scheduler); // One kernel lock per probe
+}
+
+void get_memory_statistics(MemoryStatistics & statistics)
+{
+	g_rtos.m_scheduler.lock_acquire();
+	statistics.used_size = g_rtos.m_mem_allocator.get_used_size();
+	statistics.unused_size = g_rtos.m_mem_allocator.get_unused_size();
+	g_rtos.m_scheduler.lock_release();
+
+	statistics.largest_free_size = measure_largest_free_size(g_rtos.m_mem_allocator);
+	statistics.fragmentation_permille = (statistics.largest_free_size >= statistics.unused_size) ? 0 : // The heap may have changed in between
+			1000u - (size_t) (((uint64_t) statistics.largest_free_size * 1000u) / statistics.unused_size);
+}
+
 
 
 
@@ -10,8 +10,10 @@
 #include "./Source/PublicApi/rtos.hpp"
 #include "rtos_scheduler.hpp"
 #include "rtos_system_timer.hpp"
-#include "./External/MyLib/tx_memory_halffit.hpp"
+#include "rtos_allocator.hpp"
+#include "rtos_heap_profiler.hpp"
 #include <utility>
+#include <type_traits>
 
 
 namespace RTOS
@@ -25,13 +27,32 @@ public:
 	static constexpr size_t const CoreFrequency = 16000000;
 	static constexpr size_t const TickPerSecond = 1000;
 	static constexpr size_t const CoreCyclePerTick = CoreFrequency / TickPerSecond;
+	static constexpr size_t const CoreCyclePerMicrosecond = CoreFrequency / 1000000u; static_assert(CoreCyclePerMicrosecond * 1000000u == CoreFrequency);
+	static constexpr size_t const TickTolerance = 8u * TickTimer::CoreCyclePerTimerCycle; // Core cycles by which a timer interrupt may precede its target (countdown granularity, timer rounding)
+	static constexpr bool const UseTlsfAllocator = false; // Serve RTOS::alloc with AllocatorTlsf (bounded time, better fit) instead of AllocatorHalfFit
+
+	typedef std::conditional<UseTlsfAllocator, AllocatorTlsf, AllocatorHalfFitMeasured>::type MemAllocator;
+
+	struct AllocHeader // Precedes each block of RTOS::alloc
+	{
+		size_t												m_size_class;	// Overwritten by the link of a block in a cache
+#ifdef RTOS_HEAP_PROFILER_ENABLE
+		HeapRecord										m_record;
+#endif
+	};
+
+	static constexpr size_t const AllocHeaderSize = (sizeof(AllocHeader) + 7u) & ~(size_t) 7u; // Keeps the double-word alignment
+	static constexpr size_t const AllocClassSizeLog2 = 4; // Size of the smallest class
+	static constexpr size_t const AllocLargeClass = AllocCache::ClassCount; // Blocks that bypass the caches
+	static constexpr size_t const AllocCacheBatch = 4; // Most blocks moved between a cache and m_mem_allocator per kernel lock
+	static constexpr size_t const AllocCacheBatchSize = 128; // Bytes of payload moved per kernel lock, which limits the batch of the larger classes
 
 
 public:
 
 	SystemTimer					m_system_timer;
 
-	AllocatorHalfFit 		m_mem_allocator;
+	MemAllocator 				m_mem_allocator;
 
 	Scheduler						m_scheduler;
 
@@ -52,6 +73,40 @@ public:
 
 	__attribute__((noreturn)) void initialize(FunctionPtr entry, size_t stack_size, void * mem_ptr, size_t mem_size);
 
+	void * alloc(size_t size);
+	void free(void * mem_ptr);
+	void release_alloc_cache(ThreadImpl & thread);
+
+private:
+
+	static size_t get_alloc_class(size_t size)
+	{
+		if (size <= (1u << AllocClassSizeLog2)) {return 0;}
+		size_t size_class = sizeof(size_t) * 8u - __builtin_clzl(size - 1u) - AllocClassSizeLog2; // ceil(log2(size)) - AllocClassSizeLog2
+		return size_class < AllocLargeClass ? size_class : AllocLargeClass;
+	}
+
+	static size_t get_alloc_class_size(size_t size_class)
+	{
+		return (size_t) 1 << (size_class + AllocClassSizeLog2);
+	}
+
+	static size_t get_alloc_cache_batch(size_t size_class)
+	// AllocCacheBatch blocks of the small classes, down to 1 block of 128 or 256 bytes, so that a cache does not pin much of a small heap
+	{
+		size_t batch = AllocCacheBatchSize >> (size_class + AllocClassSizeLog2);
+		return batch > AllocCacheBatch ? AllocCacheBatch : (batch > 0 ? batch : 1u);
+	}
+
+	static size_t get_alloc_cache_depth(size_t size_class) // Blocks kept per thread and class
+	{
+		return 2u * get_alloc_cache_batch(size_class);
+	}
+
+	ThreadImpl * get_allocating_thread(void);
+	void * alloc_locked(size_t size);
+	void free_locked(void * block);
+
 public:
 
 	static RTOSImpl & get_rtos_from_m_scheduler(Scheduler & scheduler)
@@ -64,6 +119,13 @@ public:
 		return *reinterpret_cast<RTOSImpl *>(reinterpret_cast<size_t>(&system_timer) - __builtin_offsetof(RTOSImpl, m_system_timer));
 	}
 
+#ifdef RTOS_HEAP_PROFILER_ENABLE
+	static void const * get_mem_ptr_from_m_record(HeapRecord const & record)
+	{
+		return reinterpret_cast<void const *>(reinterpret_cast<size_t>(&record) - __builtin_offsetof(AllocHeader, m_record) + AllocHeaderSize);
+	}
+#endif
+
 };
 
 
@@ -22,9 +22,9 @@ public:
 	static constexpr size_t const MAX_PRIORITY = 0;
 	static constexpr size_t const MIN_PRIORITY = INVALID_PRIORITY - 1;
 
-	static constexpr size_t const HIGHEST_BIT_MASK = 0x80000000; static_assert(HIGHEST_BIT_MASK != 0); static_assert((HIGHEST_BIT_MASK << 1) == 0);
+	static constexpr size_t const HIGHEST_BIT_MASK = (size_t) 1 << (sizeof(size_t) * 8 - 1); static_assert(HIGHEST_BIT_MASK != 0); static_assert((HIGHEST_BIT_MASK << 1) == 0);
 
-	static constexpr size_t const ADDRESS_BYTE_SIZE_LOG2 = 2;
+	static constexpr size_t const ADDRESS_BYTE_SIZE_LOG2 = (sizeof(size_t) == 8) ? 3 : 2; // 64-bit for the POSIX port
 	static constexpr size_t const LINKEDCYCLE_BYTE_SIZE_LOG2 = ADDRESS_BYTE_SIZE_LOG2 + 1;
 	static constexpr size_t const ADDRESS_BYTE_SIZE = 1u << ADDRESS_BYTE_SIZE_LOG2; static_assert(ADDRESS_BYTE_SIZE == sizeof(size_t));
 	static constexpr size_t const LINKEDCYCLE_BYTE_SIZE = 1u << LINKEDCYCLE_BYTE_SIZE_LOG2; static_assert(LINKEDCYCLE_BYTE_SIZE == sizeof(TXLib::LinkedCycle));
@@ -57,10 +57,11 @@ public:
 	size_t get_highest_priority(void) const
 	{
 		static_assert(PRIORITY_BLOCK == 1);
-		return (m_occupancy == 0) ? INVALID_PRIORITY : __builtin_clz(m_occupancy);
-		/* NOTE: The above return value should be equivalent to __builtin_clz(m_occupancy).
-		 * However, g++ seems to expect __builtin_clz to take value between 0 and 31,
-		 *  and optimizes the inequality (get_highest_priority() < 32) into (true)
+		static_assert(sizeof(size_t) == sizeof(unsigned long));
+		return (m_occupancy == 0) ? INVALID_PRIORITY : __builtin_clzl(m_occupancy);
+		/* NOTE: The above return value should be equivalent to __builtin_clzl(m_occupancy).
+		 * However, g++ expects __builtin_clzl to take value between 0 and INVALID_PRIORITY - 1 (31 on Cortex-M, 63 on the 64-bit POSIX port),
+		 *  and optimizes the inequality (get_highest_priority() < INVALID_PRIORITY) into (true)
 		 *  This return value prevents such incorrect optimization */
 	}
 
@@ -15,11 +15,42 @@ namespace RTOS
 {
 
 
+constexpr char const * Profiler::ProfileList[];
+
+
+
+
+#ifdef RTOS_PROFILER_ENABLE
+
 Profiler::GetTimeFunc Profiler::s_get_time_func = nullptr;
-size_t Profiler::s_time_start;
-size_t Profiler::s_last_delay;
-size_t Profiler::s_max_delay;
-size_t Profiler::s_last_profile_index;
+ProfileStatistics Profiler::s_statistics[Profiler::ProfileCount];
+Profiler::Frame Profiler::s_frames[Profiler::MaxNestingDepth];
+size_t Profiler::s_depth;
+
+size_t get_profile_report(ProfileStatistics * report, size_t capacity)
+{
+	for (size_t i = 0; i < capacity && i < Profiler::ProfileCount; i++)
+	{
+		Profiler::read(i, report[i]);
+	}
+	return Profiler::ProfileCount;
+}
+
+void reset_profile_statistics(void)
+{
+	Profiler::reset();
+}
+
+#else
+
+size_t get_profile_report(ProfileStatistics * report, size_t capacity)
+{
+	return 0;
+}
+
+void reset_profile_statistics(void) {}
+
+#endif
 
 
 } // namespace RTOS
@@ -7,19 +7,14 @@
 
 #pragma once
 
-#include "./Source/Driver/cortexm3_core.hpp"
+#include "./Source/Driver/rtos_port.hpp"
+#include "rtos_config.hpp"
 #include "./External/MyLib/tx_assert.h"
-#include "./External/CMSIS/Include/cmsis_compiler.h"
+#include "./Source/PublicApi/rtos.hpp"
 #include <stddef.h>
 #include <stdint.h>
 
 
-#ifdef RTOS_PROFILER_ENABLE // Guard against duplicated directives
-	#error
-#endif
-
-#define RTOS_PROFILER_ENABLE
-
 #ifdef RTOS_PROFILER_ENABLE
 
 	#define RTOS_PROFILER_INIT(input) 				Profiler::initialize(input)
@@ -41,13 +36,33 @@ namespace RTOS
 
 
 class Profiler
+/* Per-section statistics of the kernel sections marked by RTOS_PROFILER_START / RTOS_PROFILER_STOP
+ * Sections may nest (e.g. systick_update interrupting a thread-level section); the time spent in a nested section
+ *  is recorded for the nested section only and subtracted from the enclosing one. Sections must be closed on the core
+ *  they were opened on before any context switch, which holds since the scheduler switches context on lock release.
+ */
 {
 private:
 	static constexpr char const * ProfileList[] =
 	{
-//			"sleep",
 			"systick_update",
-//			"msgqueue_push",
+			"deferred_tick_update",
+			"kill_thread",
+			"pause_thread",
+			"unpause_thread",
+			"relinquish",
+			"sleep",
+			"mutex_lock",
+			"mutex_try_lock",
+			"mutex_unlock",
+			"msgqueue_pull",
+			"msgqueue_try_pull",
+			"msgqueue_push",
+			"mempool_alloc",
+			"mempool_try_alloc",
+			"mempool_free",
+			"notify",
+			"wait_notification",
 	};
 
 	static constexpr bool identical_string(char const * string1, char const * string2)
@@ -61,21 +76,57 @@ private:
 		return false;
 	}
 
-	static constexpr size_t NullIndex = ~0u;
-
-
-
 public:
+	static constexpr size_t const NullIndex = ~0u;
+	static constexpr size_t const ProfileCount = sizeof(ProfileList) / sizeof(char const *);
+	static constexpr size_t const MaxNestingDepth = 4; // Thread-level section plus nested interrupt sections
 
 	typedef size_t (*GetTimeFunc)(void);
 
+	struct Frame
+	{
+		size_t								profile_index;
+		size_t								time_start;
+		size_t								nested_time; // Time spent in nested sections since time_start
+	};
+
 
 public:
 	static GetTimeFunc				s_get_time_func;
-	static size_t							s_time_start;
-	static size_t							s_last_delay;
-	static size_t							s_max_delay;
-	static size_t							s_last_profile_index;
+	static ProfileStatistics	s_statistics[ProfileCount];
+	static Frame							s_frames[MaxNestingDepth];
+	static size_t							s_depth;
+
+
+private:
+
+	static size_t mask_interrupts(void)
+	// Sections usually run with the kernel interrupts already masked by the kernel lock
+	{
+		return CoreInterrupt::mask_kernel_interrupts();
+	}
+
+	static void restore_interrupts(size_t state)
+	{
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+
+	static size_t get_histogram_index(size_t duration)
+	{
+		if (duration == 0) {return 0;}
+		size_t index = sizeof(size_t) * 8u - 1u - __builtin_clzl(duration);
+		return index < ProfileHistogramSize ? index : ProfileHistogramSize - 1u;
+	}
+
+	static void record(size_t profile_index, size_t duration)
+	{
+		ProfileStatistics & statistics = s_statistics[profile_index];
+		statistics.count++;
+		statistics.total_cycles += duration;
+		if (duration < statistics.min_cycles) {statistics.min_cycles = duration;}
+		if (duration > statistics.max_cycles) {statistics.max_cycles = duration;}
+		statistics.histogram[get_histogram_index(duration)]++;
+	}
 
 
 public:
@@ -85,13 +136,36 @@ public:
 	static void initialize(GetTimeFunc func)
 	{
 		s_get_time_func = func;
-		s_max_delay = 0;
-		s_last_profile_index = NullIndex;
+		s_depth = 0;
+		reset();
+	}
+
+	static void reset(void)
+	{
+		for (size_t i = 0; i < ProfileCount; i++)
+		{
+			size_t state = mask_interrupts();
+			s_statistics[i] = ProfileStatistics{};
+			s_statistics[i].name = ProfileList[i];
+			s_statistics[i].min_cycles = ~(size_t) 0;
+			restore_interrupts(state);
+		}
+	}
+
+	static bool read(size_t profile_index, ProfileStatistics & statistics)
+	/* Copy the statistics of one section; the copy is consistent with respect to the kernel */
+	{
+		if (profile_index >= ProfileCount) {return false;}
+
+		size_t state = mask_interrupts();
+		statistics = s_statistics[profile_index];
+		restore_interrupts(state);
+		return true;
 	}
 
 	static constexpr size_t get_index(char const * name)
 	{
-		for (size_t i = 0; i < sizeof(ProfileList) / sizeof(char const *); i++)
+		for (size_t i = 0; i < ProfileCount; i++)
 		{
 			if (identical_string(name, ProfileList[i]))
 			{
@@ -104,46 +178,47 @@ public:
 	static void start(size_t profile_index)
 	{
 		TX_ASSERT(is_initialized());
-		TX_ASSERT(s_last_profile_index == NullIndex);
 
-		s_last_profile_index = profile_index;
-		s_time_start = CoreClock::get_cycle_count();
+		size_t state = mask_interrupts();
+		TX_ASSERT(s_depth < MaxNestingDepth);
+
+		Frame & frame = s_frames[s_depth++];
+		frame.profile_index = profile_index;
+		frame.nested_time = 0;
+		frame.time_start = CoreClock::get_cycle_count();
+		restore_interrupts(state);
 	}
 
-	static void stop(void)
+	static void stop(size_t profile_index)
 	{
 		TX_ASSERT(is_initialized());
-		TX_ASSERT(s_last_profile_index != NullIndex);
 
-		s_last_delay = CoreClock::get_cycle_count() - s_time_start;
-		if (s_last_delay > s_max_delay)
-		{
-			s_max_delay = s_last_delay;
-		}
-		if (s_last_delay > 500)
+		size_t state = mask_interrupts();
+		size_t time_stop = CoreClock::get_cycle_count();
+		TX_ASSERT(s_depth > 0 && s_frames[s_depth - 1].profile_index == profile_index); // Sections must be properly nested
+
+		Frame & frame = s_frames[--s_depth];
+		size_t elapsed_time = time_stop - frame.time_start;
+		if (s_depth > 0)
 		{
-			__NOP();
+			s_frames[s_depth - 1].nested_time += elapsed_time;
 		}
-		__NOP();
-		s_last_profile_index = NullIndex;
+		record(profile_index, elapsed_time - frame.nested_time);
+		restore_interrupts(state);
 	}
 
 	template <size_t ProfileIndex>
 	static void start(void)
 	{
-		if (ProfileIndex != NullIndex)
-		{
-			start(ProfileIndex);
-		}
+		static_assert(ProfileIndex != NullIndex, "The section name is missing in Profiler::ProfileList");
+		start(ProfileIndex);
 	}
 
 	template <size_t ProfileIndex>
 	static void stop(void)
 	{
-		if (ProfileIndex != NullIndex)
-		{
-			stop();
-		}
+		static_assert(ProfileIndex != NullIndex, "The section name is missing in Profiler::ProfileList");
+		stop(ProfileIndex);
 	}
 
 };
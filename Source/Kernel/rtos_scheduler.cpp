@@ -8,7 +8,13 @@
 #include "rtos_scheduler.hpp"
 #include "rtos_impl.hpp"
 #include "rtos_profiler.hpp"
-#include "./Source/Driver/cortexm3_core.hpp"
+#include "rtos_trace.hpp"
+#include "rtos_critical_section.hpp"
+#include "rtos_idle_governor.hpp"
+#include "./Source/Driver/rtos_port.hpp"
+#if defined(__ARM_FP) // Cortex-M4F port
+	#include "./Source/Driver/cortexm4f_core.hpp"
+#endif
 #include "./External/MyLib/tx_assert.h"
 #include "./External/MyLib/tx_memory_halffit.hpp"
 #include "./External/MyLib/tx_arithmetic.hpp"
@@ -24,18 +30,34 @@ extern RTOSImpl g_rtos;
 static Scheduler & g_scheduler = g_rtos.m_scheduler;
 static SystemTimer & g_system_timer = g_rtos.m_system_timer;
 
+bool ThreadImpl::s_paint_stack = false;
+constexpr uint32_t const Scheduler::LoadAverageWeights[];
+
 
 
 
 
 
 void ThreadImpl::initialize_self(FunctionPtr entry, size_t entry_argument, size_t priority, size_t stack_size)
+{
+	TX_ASSERT(m_state == State::Reset);
+
+	void * stack_ptr = alloc(stack_size);
+	TX_ASSERT(stack_ptr != nullptr);
+
+	initialize_self(entry, entry_argument, priority, stack_ptr, stack_size);
+	m_owns_stack = true;
+}
+
+void ThreadImpl::initialize_self(FunctionPtr entry, size_t entry_argument, size_t priority, void * stack_ptr, size_t stack_size)
 {
 	TX_ASSERT((stack_size & 0b111) == 0);
+	TX_ASSERT(((size_t) stack_ptr & 0b111) == 0); // The stack pointer is aligned to double-word
 	TX_ASSERT(m_state == State::Reset);
 
-	m_stack_begin = (size_t) alloc(stack_size);
+	m_stack_begin = (size_t) stack_ptr;
 	m_stack_end = m_stack_begin + stack_size;
+	m_owns_stack = false;
 	m_sp = (void *) m_stack_end;
 	m_entry = entry;
 	m_entry_argument = entry_argument;
@@ -43,12 +65,37 @@ void ThreadImpl::initialize_self(FunctionPtr entry, size_t entry_argument, size_
 	m_effective_priority = priority;
 	m_priority_list = nullptr;
 	m_cpu_cycle_used = 0;
+	m_cpu_cycle_reported = 0;
 	m_state = State::Paused;
 	m_blocking_mutex = nullptr;
+	m_handed_off_message = 0;
+	m_message_handed_off = false;
+	m_expire_in_cycles = false;
+	m_notification = 0;
+	m_notification_pending = false;
+	for (size_t i = 0; i < AllocCache::ClassCount; i++)
+	{
+		m_alloc_cache.m_blocks[i] = nullptr;
+		m_alloc_cache.m_counts[i] = 0;
+	}
+	m_heap_tag = (size_t) static_cast<Thread *>(this);
+	m_bound_arenas = nullptr;
 
 	populate_stack_context();
+	TX_ASSERT((size_t) m_sp > get_usable_stack_begin()); // Failing means that the stack is too small
+
+	g_scheduler.register_thread(*this);
 }
 
+#if defined(RTOS_PORT_POSIX)
+
+struct ThreadImpl::StackContext
+{
+	ucontext_t	context; // Saved by CoreContext::switch_context; the thread runs on the stack below it
+};
+
+#else
+
 struct ThreadImpl::StackContext
 {
 	size_t	r4;
@@ -59,6 +106,9 @@ struct ThreadImpl::StackContext
 	size_t	r9;
 	size_t	r10;
 	size_t	r11;
+#if defined(__ARM_FP)
+	size_t	exc_return; // Bit 4 is cleared if the thread has a floating-point context, in which case s16-s31 are stored below r4
+#endif
 	size_t	r0;
 	size_t	r1;
 	size_t	r2;
@@ -69,17 +119,37 @@ struct ThreadImpl::StackContext
 	size_t	psr;
 };
 
+#endif
+
+size_t ThreadImpl::get_usable_stack_begin(void) const
+{
+	return UseMpuStackGuard ? CoreMpu::get_stack_guard_end(m_stack_begin) : m_stack_begin + sizeof(size_t);
+}
+
 void ThreadImpl::populate_stack_context(void)
 {
+#if defined(RTOS_PORT_POSIX)
+	m_sp = (void *)(((size_t)m_sp - sizeof(StackContext)) & ~(CoreContext::StackAlignment - 1u));
+	StackContext * context = (StackContext *) m_sp;
+
+	size_t stack_begin = get_usable_stack_begin();
+	CoreContext::initialize<&Scheduler::thread_entry>(context->context, stack_begin, (size_t) m_sp - stack_begin);
+#else
 	m_sp = (void *)((size_t)m_sp - sizeof(StackContext));
 	StackContext * context = (StackContext *) m_sp;
 
 	context->pc = (size_t) &Scheduler::thread_entry;
 	context->psr = (1u << 24);
+#if defined(__ARM_FP)
+	context->exc_return = CoreFpu::ExcReturnThreadPsp; // New threads start without floating-point context
+#endif
+#endif
 
 	*((size_t *) m_stack_begin) = StackLimitIdentifier;
 
-	if (PrefillStack)
+	m_stack_painted = s_paint_stack;
+	m_stack_used_begin = (size_t) m_sp;
+	if (m_stack_painted)
 	{
 		for (size_t i = 0; (size_t)((size_t*) m_stack_begin + i) < (size_t) m_sp; i++)
 		{
@@ -95,9 +165,11 @@ void ThreadImpl::populate_stack_context(void)
 
 void CoreInfo::initialize(void)
 {
-	m_idle_thread.initialize_self(& Scheduler::idle_thread, 0, PriorityList::INVALID_PRIORITY, 0x100);
+	m_idle_thread.initialize_self(& Scheduler::idle_thread, 0, PriorityList::INVALID_PRIORITY, m_idle_stack, IdleStackSize);
 	m_thread_running = &m_idle_thread;
 	m_thread_on_core = &m_idle_thread;
+	m_last_context_switch_cycle = CoreClock::get_cycle_count();
+	m_elapsed_cycles = 0;
 }
 
 
@@ -105,6 +177,8 @@ void CoreInfo::initialize(void)
 
 
 
+#if RTOS_CONFIG_EXPIRATION_LIST
+
 void ExpirationList::initialize(TimeType current_time)
 {
 	m_earliest_unsorted_expire_time = current_time + TimeType::get_max_positive();
@@ -185,16 +259,42 @@ TXLib::LinkedCycle & ExpirationList::remove_threads_sharing_smallest_expire_time
 	return *removed;
 }
 
+#endif
+
+#if !RTOS_CONFIG_SLEEP_LIST || !RTOS_CONFIG_SOFT_BLOCK_LIST
+
+static void * alloc_heap_storage(size_t size)
+/* The heaps grow on insertion, with the kernel lock held; RTOS::alloc may take the lock, which does not nest,
+ * so the storage is taken from the allocator directly */
+{
+	return g_rtos.m_mem_allocator.alloc(size);
+}
+
+static void free_heap_storage(void * block)
+{
+	g_rtos.m_mem_allocator.free(block);
+}
+
+#endif
+
+#if !RTOS_CONFIG_SLEEP_LIST
+
 void SleepHeap::initialize(void)
 {
-	m_heap.initialize(alloc, free, 2);
+	m_heap.initialize(alloc_heap_storage, free_heap_storage, 2);
 }
 
+#endif
+
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
+
 void ExpireHeap::initialize(void)
 {
-	m_heap.initialize(alloc, free, 2);
+	m_heap.initialize(alloc_heap_storage, free_heap_storage, 2);
 }
 
+#endif
+
 
 
 
@@ -211,10 +311,15 @@ void Scheduler::thread_entry(void)
 
 	(*thread.m_entry)(thread.m_entry_argument); // Execute user-space code
 
-	TX_ASSERT(*((size_t *)thread.m_stack_begin) == ThreadImpl::StackLimitIdentifier); // Failing means potential stack overflow
+	if (!ThreadImpl::UseMpuStackGuard) // The stack limit identifier lies inside the guard region otherwise
+	{
+		TX_ASSERT(*((size_t *)thread.m_stack_begin) == ThreadImpl::StackLimitIdentifier); // Failing means potential stack overflow
+	}
 
 
 	Mutex::unlock_all_mutex(thread);
+	Arena::release_bound_arenas(thread);
+	g_rtos.release_alloc_cache(thread);
 
 	g_scheduler.lock_acquire();
 	g_scheduler.change_running_thread_to_terminated(g_scheduler.m_core);
@@ -227,56 +332,201 @@ void Scheduler::thread_entry(void)
 
 
 // Context switch
+#if defined(RTOS_PORT_POSIX)
+
+extern "C" void PendSV_Handler(void)
+// Interrupts are masked by the caller (see CoreInterrupt::run_pending_pendsv)
+{
+	RTOS_CRITICAL_SECTION_ENTER(reinterpret_cast<void const *>(&PendSV_Handler));
+
+	g_scheduler.deferred_tick_update();
+
+	ThreadImpl & thread_out = *g_scheduler.m_core.m_thread_on_core;
+	ThreadImpl & thread_in = *g_scheduler.m_core.m_thread_running;
+
+	RTOS_TRACE_THREAD(ContextSwitch, thread_in, &thread_out, nullptr);
+
+	// Update cpu cycle of the outgoing thread
+	g_scheduler.update_cpu_cycles(g_scheduler.m_core);
+
+	// Broadcast removal of context
+	g_scheduler.m_core.m_thread_on_core = &thread_in;
+
+	RTOS_CRITICAL_SECTION_EXIT(); // The incoming thread returns from its own call to switch_context
+	if (&thread_out != &thread_in)
+	{
+		CoreContext::switch_context(((ThreadImpl::StackContext *) thread_out.m_sp)->context, ((ThreadImpl::StackContext *) thread_in.m_sp)->context);
+	}
+}
+
+#else
+
+#ifdef RTOS_CRITICAL_SECTION_ENABLE
+extern "C" __attribute__((used)) void critical_section_enter_pendsv(void)
+{
+	RTOS_CRITICAL_SECTION_ENTER(reinterpret_cast<void const *>(&PendSV_Handler));
+}
+
+extern "C" __attribute__((used)) void critical_section_exit_pendsv(void)
+{
+	RTOS_CRITICAL_SECTION_EXIT();
+}
+#endif
+
+extern "C" __attribute__((used)) void deferred_tick_update_pendsv(void)
+{
+	g_scheduler.deferred_tick_update();
+}
+
+#ifdef RTOS_TRACE_ENABLE
+extern "C" __attribute__((used)) void trace_context_switch(void)
+// Called by PendSV_Handler while m_thread_on_core is still the outgoing thread
+{
+	RTOS_TRACE_THREAD(ContextSwitch, *g_scheduler.m_core.m_thread_running, g_scheduler.m_core.m_thread_on_core, nullptr);
+}
+#endif
+
 extern "C" __attribute__((naked, flatten)) void PendSV_Handler(void)
 {
-	__disable_irq();
+	// Mask the kernel interrupts only; PendSV has the lowest priority, so BASEPRI was 0 on entry
+	__set_BASEPRI(CoreInterrupt::KernelBasepri);
+	__ISB();
 	__DMB();
 
+#ifdef RTOS_CRITICAL_SECTION_ENABLE
+	// r0-r3 and r12 are stacked by the exception entry, r4-r11 are preserved by the callee, lr holds EXC_RETURN
+	__asm volatile(
+			"push {r0, lr} \n"
+			"bl critical_section_enter_pendsv \n"
+			"pop {r0, lr}"
+			:
+			:
+			: "r1", "r2", "r3", "r12", "memory");
+#endif
+
 	// Load psp to register r1
 	__asm volatile("mrs r1, psp");
 
 	// Save registers
+#if defined(__ARM_FP)
+	// The floating-point callee-saved registers are only saved for threads that use the FPU (bit 4 of EXC_RETURN is cleared)
+	// Storing them also completes the lazy stacking of s0-s15 by the hardware
+	__asm volatile(
+			"tst lr, %0 \n"
+			"it eq \n"
+			"vstmdbeq r1!, {s16-s31} \n"
+			"stmdb r1!, {r4-r11, lr}"
+			:
+			: "i"(CoreFpu::ExcReturnNoFpuContextMsk));
+#else
 	__asm volatile("stmdb r1!, {r4-r11}");
+#endif
 
 	// Save psp to ThreadInfo
 	__asm volatile("str r1, [%0]" : : "r"(&g_scheduler.m_core.m_thread_on_core->m_sp) : "r1");
 
-	// Broadcast removal of context
-	__asm volatile("mov %0, %1" : "=r"(g_scheduler.m_core.m_thread_on_core) : "r"(g_scheduler.m_core.m_thread_running));
+	// Process the tick deferred by SysTick_Handler, which may select another thread; r1 is reloaded below
+	__asm volatile(
+			"push {r0, lr} \n"
+			"bl deferred_tick_update_pendsv \n"
+			"pop {r0, lr}"
+			:
+			:
+			: "r1", "r2", "r3", "r12", "memory");
+
+#ifdef RTOS_TRACE_ENABLE
+	// Record the switch; r4-r11 are saved and r1 is reloaded below, lr holds EXC_RETURN
+	__asm volatile(
+			"push {r0, lr} \n"
+			"bl trace_context_switch \n"
+			"pop {r0, lr}"
+			:
+			:
+			: "r1", "r2", "r3", "r12", "memory");
+#endif
 
-	// Update cpu cycle
+#ifdef RTOS_CPU_ACCOUNTING_ENABLE
+	// Update cpu cycle of the outgoing thread and of the core (64-bit counters, see Scheduler::update_cpu_cycles)
 	__asm volatile(
-			"mov r8, lr \n"
 			"ldr r4, [%0] \n"
 			"ldr r5, [%1] \n"
-			"ldr r6, [%2] \n"
-			"sub r7, r4, r5 \n"
-			"add r7, r7, r6 \n"
 			"str r4, [%1] \n"
-			"str r7, [%2] \n"
-			"mov lr, r8"
+			"sub r4, r4, r5 \n"
+			"ldrd r5, r6, [%2] \n"
+			"adds r5, r5, r4 \n"
+			"adc r6, r6, #0 \n"
+			"strd r5, r6, [%2] \n"
+			"ldrd r5, r6, [%3] \n"
+			"adds r5, r5, r4 \n"
+			"adc r6, r6, #0 \n"
+			"strd r5, r6, [%3]"
 			:
 			: "r"(&DWT->CYCCNT), // This can be replaced with "r"(CoreClock::get_cycle_counter_address()) if the compiler flattens the function call
 				"r"(&g_scheduler.m_core.m_last_context_switch_cycle),
-				"r"(&g_scheduler.m_core.m_thread_running->m_cpu_cycle_used)
-			: "memory");
+				"r"(&g_scheduler.m_core.m_thread_on_core->m_cpu_cycle_used),
+				"r"(&g_scheduler.m_core.m_elapsed_cycles)
+			: "r4", "r5", "r6", "cc", "memory");
+#endif
+
+	// Broadcast removal of context
+	__asm volatile("mov %0, %1" : "=r"(g_scheduler.m_core.m_thread_on_core) : "r"(g_scheduler.m_core.m_thread_running));
+
+	// Move the stack guard below the stack of the incoming thread (see CoreMpu::get_stack_guard_begin)
+	if (ThreadImpl::UseMpuStackGuard)
+	{
+		__asm volatile(
+				"ldr r2, [%0] \n"
+				"add r2, r2, %2 \n"
+				"bic r2, r2, %2 \n"
+				"orr r2, r2, %3 \n"
+				"str r2, [%1] \n"
+				"dsb"
+				:
+				: "r"(&g_scheduler.m_core.m_thread_running->m_stack_begin),
+					"r"(CoreMpu::get_region_base_address_register_address()),
+					"i"(CoreMpu::StackGuardSize - 1u),
+					"i"(CoreMpu::get_region_base_address_flags())
+				: "r2", "memory");
+	}
 
 	// Load psp from ThreadInfo
 	__asm volatile("ldr r1, [%0]" : : "r"(&g_scheduler.m_core.m_thread_running->m_sp));
 
 	// Load registers
+#if defined(__ARM_FP)
+	__asm volatile(
+			"ldm r1!, {r4-r11, lr} \n"
+			"tst lr, %0 \n"
+			"it eq \n"
+			"vldmiaeq r1!, {s16-s31}"
+			:
+			: "i"(CoreFpu::ExcReturnNoFpuContextMsk));
+#else
 	__asm volatile("ldm r1!, {r4-r11}");
+#endif
 
 	// Set psp
 	__asm volatile("msr psp, r1");
 
+#ifdef RTOS_CRITICAL_SECTION_ENABLE
+	__asm volatile(
+			"push {r0, lr} \n"
+			"bl critical_section_exit_pendsv \n"
+			"pop {r0, lr}"
+			:
+			:
+			: "r1", "r2", "r3", "r12", "memory");
+#endif
+
 	__DMB();
-	__enable_irq();
+	__set_BASEPRI(0);
 
 	// Return
 	__asm volatile("bx  lr");
 }
 
+#endif
+
 
 
 
@@ -289,7 +539,11 @@ extern "C" __attribute__((naked, flatten)) void PendSV_Handler(void)
 
 void Scheduler::set_effective_priority(ThreadImpl & thread, size_t priority)
 {
-	thread.m_effective_priority = priority;
+	if (thread.m_effective_priority != priority)
+	{
+		thread.m_effective_priority = priority;
+		RTOS_TRACE_THREAD(Priority, thread, nullptr, m_core.m_thread_running);
+	}
 
 	if (thread.m_priority_list != nullptr)
 	{
@@ -324,6 +578,7 @@ void Scheduler::change_paused_thread_to_ready(ThreadImpl & thread)
 	thread.m_state = ThreadImpl::State::Ready;
 	thread.m_priority_list = &m_ready_threads;
 	m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
 void Scheduler::change_ready_thread_to_paused(ThreadImpl & thread)
@@ -333,6 +588,7 @@ void Scheduler::change_ready_thread_to_paused(ThreadImpl & thread)
 	thread.m_priority_list->remove_link(thread.m_priority_link);
 	thread.m_priority_list = nullptr;
 	thread.m_state = ThreadImpl::State::Paused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
 void Scheduler::change_top_ready_thread_to_running(CoreInfo & core)
@@ -353,6 +609,7 @@ void Scheduler::change_top_ready_thread_to_running(CoreInfo & core)
 		// Execute idle thread
 		core.m_thread_running = &core.m_idle_thread;
 	}
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
 }
 
 bool Scheduler::exchange_top_ready_thread_with_running_thread(CoreInfo & core, size_t skip_priority)
@@ -366,10 +623,12 @@ bool Scheduler::exchange_top_ready_thread_with_running_thread(CoreInfo & core, s
 		thread_exit.m_state = ThreadImpl::State::Ready;
 		thread_exit.m_priority_list = &m_ready_threads;
 		m_ready_threads.insert(thread_exit.m_priority_link, thread_exit.m_effective_priority);
+		RTOS_TRACE_THREAD(State, thread_exit, nullptr, nullptr);
 
 		core.m_thread_running = & ThreadImpl::get_thread_from_m_priority_link(*link);
 		core.m_thread_running->m_state = ThreadImpl::State::Running;
 		core.m_thread_running->m_priority_list = nullptr;
+		RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
 
 		return true;
 	}
@@ -384,6 +643,7 @@ void Scheduler::change_running_thread_to_ready(CoreInfo & core)
 	core.m_thread_running->m_state = ThreadImpl::State::Ready;
 	core.m_thread_running->m_priority_list = &m_ready_threads;
 	m_ready_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
 
 	core.m_thread_running = nullptr;
 }
@@ -393,6 +653,7 @@ void Scheduler::change_running_thread_to_terminated(CoreInfo & core)
 	TX_ASSERT(core.m_thread_running->m_state == ThreadImpl::State::Running);
 
 	core.m_thread_running->m_state = ThreadImpl::State::Terminated;
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
 	core.m_thread_running = nullptr;
 }
 
@@ -401,6 +662,7 @@ void Scheduler::change_running_thread_to_paused(CoreInfo & core)
 	TX_ASSERT(core.m_thread_running->m_state == ThreadImpl::State::Running);
 
 	core.m_thread_running->m_state = ThreadImpl::State::Paused;
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
 	core.m_thread_running = nullptr;
 }
 
@@ -409,15 +671,22 @@ void Scheduler::change_running_thread_to_sleeping(CoreInfo & core, TimeType expi
 	core.m_thread_running->m_state = ThreadImpl::State::Sleeping;
 	core.m_thread_running->m_expire_time = expire_time;
 
-	if (UseListVersionForThreadSleep)
-	{
-		TX_ASSERT(expire_time > g_system_timer.get_tick());
-		m_expiration_list.insert_thread(core.m_thread_running->m_expire_link, expire_time);
-	}
-	else
-	{
-		m_sleep_heap.insert(*core.m_thread_running);
-	}
+#if RTOS_CONFIG_SLEEP_LIST
+	TX_ASSERT(expire_time > g_system_timer.get_tick());
+	m_expiration_list.insert_thread(core.m_thread_running->m_expire_link, expire_time);
+#else
+	m_sleep_heap.insert(*core.m_thread_running);
+#endif
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, expire_time.m_time, nullptr);
+
+	core.m_thread_running = nullptr;
+}
+
+void Scheduler::change_running_thread_to_precisesleeping(CoreInfo & core, TimeType expire_cycle)
+{
+	core.m_thread_running->m_state = ThreadImpl::State::Sleeping;
+	insert_precise_expiration(*core.m_thread_running, expire_cycle);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, expire_cycle.m_time, nullptr);
 
 	core.m_thread_running = nullptr;
 }
@@ -430,29 +699,21 @@ void Scheduler::change_running_thread_to_mutexblocked(CoreInfo & core, Mutex & b
 	core.m_thread_running->m_blocking_mutex = &blocking_mutex;
 	core.m_thread_running->m_priority_list = &blocking_mutex.m_blocked_threads;
 	blocking_mutex.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &blocking_mutex, blocking_mutex.m_owner);
 
 	core.m_thread_running = nullptr;
 }
 
-void Scheduler::change_running_thread_to_softmutexblocked(CoreInfo & core, Mutex & blocking_mutex, TimeType expire_time)
+void Scheduler::change_running_thread_to_softmutexblocked(CoreInfo & core, Mutex & blocking_mutex, TimeType expire_time, bool in_cycles)
 {
 	increase_priority_of_blocking_mutexes_and_owners(&blocking_mutex, core.m_thread_running->m_effective_priority);
 
 	core.m_thread_running->m_state = ThreadImpl::State::SoftBlockedByMutex;
 	core.m_thread_running->m_blocking_mutex = &blocking_mutex;
 	core.m_thread_running->m_priority_list = &blocking_mutex.m_blocked_threads;
-	core.m_thread_running->m_expire_time = expire_time;
 	blocking_mutex.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
-
-	if (UseListVersionForSoftBlockExpiration)
-	{
-		TX_ASSERT(expire_time > g_system_timer.get_tick());
-		m_expiration_list.insert_thread(core.m_thread_running->m_expire_link, expire_time);
-	}
-	else
-	{
-		m_expire_heap.insert(*core.m_thread_running);
-	}
+	insert_soft_block_expiration(*core.m_thread_running, expire_time, in_cycles);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &blocking_mutex, blocking_mutex.m_owner);
 
 	core.m_thread_running = nullptr;
 }
@@ -462,44 +723,71 @@ void Scheduler::change_running_thread_to_messageblocked(CoreInfo & core, Message
 	core.m_thread_running->m_state = ThreadImpl::State::BlockedByMessage;
 	core.m_thread_running->m_priority_list = &queue.m_blocked_threads;
 	queue.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &queue, nullptr);
 	core.m_thread_running = nullptr;
 }
 
-void Scheduler::change_running_thread_to_softmessageblocked(CoreInfo & core, MessageQueue & queue, TimeType expire_time)
+void Scheduler::change_running_thread_to_softmessageblocked(CoreInfo & core, MessageQueue & queue, TimeType expire_time, bool in_cycles)
 {
 	core.m_thread_running->m_state = ThreadImpl::State::SoftBlockedByMessage;
 	core.m_thread_running->m_priority_list = &queue.m_blocked_threads;
-	core.m_thread_running->m_expire_time = expire_time;
 	queue.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	insert_soft_block_expiration(*core.m_thread_running, expire_time, in_cycles);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &queue, nullptr);
 
-	if (UseListVersionForSoftBlockExpiration)
-	{
-		TX_ASSERT(expire_time > g_system_timer.get_tick());
-		m_expiration_list.insert_thread(core.m_thread_running->m_expire_link, expire_time);
-	}
-	else
-	{
-		m_expire_heap.insert(*core.m_thread_running);
-	}
+	core.m_thread_running = nullptr;
+}
 
+void Scheduler::change_running_thread_to_poolblocked(CoreInfo & core, MemoryPool & pool)
+{
+	core.m_thread_running->m_state = ThreadImpl::State::BlockedByPool;
+	core.m_thread_running->m_priority_list = &pool.m_blocked_threads;
+	pool.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &pool, nullptr);
 	core.m_thread_running = nullptr;
 }
 
-void Scheduler::change_expired_thread_to_ready(TimeType time)
+void Scheduler::change_running_thread_to_softpoolblocked(CoreInfo & core, MemoryPool & pool, TimeType expire_time, bool in_cycles)
 {
-	if (UseListVersionForThreadSleep || UseListVersionForSoftBlockExpiration)
-	{
-		change_expired_sleeping_thread_to_ready_version_list(time);
-	}
+	core.m_thread_running->m_state = ThreadImpl::State::SoftBlockedByPool;
+	core.m_thread_running->m_priority_list = &pool.m_blocked_threads;
+	pool.m_blocked_threads.insert(core.m_thread_running->m_priority_link, core.m_thread_running->m_effective_priority);
+	insert_soft_block_expiration(*core.m_thread_running, expire_time, in_cycles);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, &pool, nullptr);
 
-	if (!UseListVersionForThreadSleep)
-	{
-		change_expired_sleeping_thread_to_ready_version_heap(time);
-	}
-	if (!UseListVersionForSoftBlockExpiration)
-	{
-		change_expired_softblocked_thread_to_ready_version_heap(time);
-	}
+	core.m_thread_running = nullptr;
+}
+
+void Scheduler::change_running_thread_to_notificationblocked(CoreInfo & core)
+// The thread is in no priority list: only notify_thread wakes it up
+{
+	core.m_thread_running->m_state = ThreadImpl::State::BlockedByNotification;
+	core.m_thread_running->m_priority_list = nullptr;
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
+	core.m_thread_running = nullptr;
+}
+
+void Scheduler::change_running_thread_to_softnotificationblocked(CoreInfo & core, TimeType expire_time)
+{
+	core.m_thread_running->m_state = ThreadImpl::State::SoftBlockedByNotification;
+	core.m_thread_running->m_priority_list = nullptr;
+	insert_soft_block_expiration(*core.m_thread_running, expire_time, false);
+	RTOS_TRACE_THREAD(State, *core.m_thread_running, nullptr, nullptr);
+
+	core.m_thread_running = nullptr;
+}
+
+void Scheduler::change_expired_thread_to_ready(TimeType time)
+{
+#if RTOS_CONFIG_EXPIRATION_LIST
+	change_expired_sleeping_thread_to_ready_version_list(time);
+#endif
+#if !RTOS_CONFIG_SLEEP_LIST
+	change_expired_sleeping_thread_to_ready_version_heap(time);
+#endif
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
+	change_expired_softblocked_thread_to_ready_version_heap(time);
+#endif
 }
 
 void Scheduler::change_sleeping_thread_to_sleepingpaused(ThreadImpl & thread)
@@ -507,6 +795,7 @@ void Scheduler::change_sleeping_thread_to_sleepingpaused(ThreadImpl & thread)
 	TX_ASSERT(thread.m_state == ThreadImpl::State::Sleeping);
 
 	thread.m_state = ThreadImpl::State::SleepingAndPaused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
 void Scheduler::change_sleepingpaused_thread_to_sleeping(ThreadImpl & thread)
@@ -514,6 +803,7 @@ void Scheduler::change_sleepingpaused_thread_to_sleeping(ThreadImpl & thread)
 	TX_ASSERT(thread.m_state == ThreadImpl::State::SleepingAndPaused);
 
 	thread.m_state = ThreadImpl::State::SleepingAndPaused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
 void Scheduler::change_top_mutexblocked_thread_to_ready(Mutex & mutex)
@@ -527,21 +817,14 @@ void Scheduler::change_top_mutexblocked_thread_to_ready(Mutex & mutex)
 
 		if (thread.m_state == ThreadImpl::State::SoftBlockedByMutex)
 		{
-			if (UseListVersionForSoftBlockExpiration)
-			{
-				m_expiration_list.remove(thread.m_expire_link);
-			}
-			else
-			{
-				bool success = m_expire_heap.remove(thread);
-				tx_assert(success);
-			}
+			remove_soft_block_expiration(thread);
 		}
 
 		thread.m_state = ThreadImpl::State::Ready;
 		thread.m_blocking_mutex = nullptr;
 		thread.m_priority_list = &m_ready_threads;
 		m_ready_threads.insert(*link, thread.m_effective_priority);
+		RTOS_TRACE_THREAD(State, thread, &mutex, m_core.m_thread_running);
 	}
 }
 
@@ -553,48 +836,118 @@ void Scheduler::change_mutexblocked_thread_to_paused(ThreadImpl & thread)
 	thread.m_priority_list = nullptr;
 	thread.m_state = ThreadImpl::State::Paused;
 	thread.m_blocking_mutex = nullptr;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
-void Scheduler::change_top_messageblocked_thread_to_ready(MessageQueue & queue)
+bool Scheduler::hand_off_message_to_top_messageblocked_thread(CoreInfo & core, MessageQueue & queue, size_t message)
+/* Write @message to the top blocked thread, bypassing the queue, and make it ready, or running if it has higher priority than the running thread
+ * Return false if no thread is blocked. The caller switches context if the running thread changed. */
 {
 	size_t blocked_priority = queue.m_blocked_threads.get_highest_priority();
+	if (blocked_priority >= PriorityList::INVALID_PRIORITY)
+	{
+		return false;
+	}
+	TX_ASSERT(queue.m_queue.is_empty()); // A thread only blocks on an empty queue, which is handed off every message until it wakes up
+
+	TXLib::LinkedCycleUnsafe * link = queue.m_blocked_threads.pop_link(blocked_priority);
+	ThreadImpl & thread = ThreadImpl::get_thread_from_m_priority_link(*link);
+	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByMessage || thread.m_state == ThreadImpl::State::SoftBlockedByMessage);
+
+	if (thread.m_state == ThreadImpl::State::SoftBlockedByMessage)
+	{
+		remove_soft_block_expiration(thread);
+	}
+
+	thread.m_handed_off_message = message;
+	thread.m_message_handed_off = true;
+
+	if (thread.m_effective_priority < core.m_thread_running->m_effective_priority)
+	{
+		change_running_thread_to_ready(core);
+		core.m_thread_running = &thread;
+		thread.m_state = ThreadImpl::State::Running;
+		thread.m_priority_list = nullptr;
+	}
+	else
+	{
+		thread.m_state = ThreadImpl::State::Ready;
+		thread.m_priority_list = &m_ready_threads;
+		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+	}
+	RTOS_TRACE_THREAD(State, thread, &queue, core.m_thread_running);
+	return true;
+}
+
+void Scheduler::change_messageblocked_thread_to_paused(ThreadImpl & thread)
+{
+	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByMessage);
+
+	thread.m_priority_list->remove_link(thread.m_priority_link);
+	thread.m_priority_list = nullptr;
+	thread.m_state = ThreadImpl::State::Paused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
+}
+
+void Scheduler::change_top_poolblocked_thread_to_ready(MemoryPool & pool)
+{
+	size_t blocked_priority = pool.m_blocked_threads.get_highest_priority();
 	if (blocked_priority < PriorityList::INVALID_PRIORITY)
 	{
-		TXLib::LinkedCycleUnsafe * link = queue.m_blocked_threads.pop_link(blocked_priority);
+		TXLib::LinkedCycleUnsafe * link = pool.m_blocked_threads.pop_link(blocked_priority);
 		ThreadImpl & thread = ThreadImpl::get_thread_from_m_priority_link(*link);
-		TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByMessage || thread.m_state == ThreadImpl::State::SoftBlockedByMessage);
+		TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByPool || thread.m_state == ThreadImpl::State::SoftBlockedByPool);
 
-		if (thread.m_state == ThreadImpl::State::SoftBlockedByMessage)
+		if (thread.m_state == ThreadImpl::State::SoftBlockedByPool)
 		{
-			if (UseListVersionForSoftBlockExpiration)
-			{
-				m_expiration_list.remove(thread.m_expire_link);
-			}
-			else
-			{
-				bool success = m_expire_heap.remove(thread);
-				tx_assert(success);
-			}
+			remove_soft_block_expiration(thread);
 		}
 
 		thread.m_state = ThreadImpl::State::Ready;
 		thread.m_priority_list = &m_ready_threads;
 		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+		RTOS_TRACE_THREAD(State, thread, &pool, m_core.m_thread_running);
 	}
 }
 
-void Scheduler::change_messageblocked_thread_to_paused(ThreadImpl & thread)
+void Scheduler::change_poolblocked_thread_to_paused(ThreadImpl & thread)
 {
-	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByMessage);
+	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByPool);
 
 	thread.m_priority_list->remove_link(thread.m_priority_link);
 	thread.m_priority_list = nullptr;
 	thread.m_state = ThreadImpl::State::Paused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
+}
+
+void Scheduler::change_notificationblocked_thread_to_ready(ThreadImpl & thread)
+{
+	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByNotification || thread.m_state == ThreadImpl::State::SoftBlockedByNotification);
+
+	if (thread.m_state == ThreadImpl::State::SoftBlockedByNotification)
+	{
+		remove_soft_block_expiration(thread);
+	}
+
+	thread.m_state = ThreadImpl::State::Ready;
+	thread.m_priority_list = &m_ready_threads;
+	m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+	RTOS_TRACE_THREAD(State, thread, nullptr, CoreInterrupt::is_in_handler_mode() ? nullptr : m_core.m_thread_running); // An interrupt wakes the thread up on behalf of no thread
+}
+
+void Scheduler::change_notificationblocked_thread_to_paused(ThreadImpl & thread)
+{
+	TX_ASSERT(thread.m_state == ThreadImpl::State::BlockedByNotification);
+
+	thread.m_state = ThreadImpl::State::Paused;
+	RTOS_TRACE_THREAD(State, thread, nullptr, nullptr);
 }
 
 
 // List version
 
+#if RTOS_CONFIG_EXPIRATION_LIST
+
 void Scheduler::change_expired_sleeping_thread_to_ready_version_list(TimeType time)
 {
 	TX_ASSERT(m_expiration_list.m_earliest_unsorted_expire_time > time);
@@ -612,27 +965,7 @@ void Scheduler::change_expired_sleeping_thread_to_ready_version_list(TimeType ti
 			do
 			{
 				thread = & ThreadImpl::get_thread_from_m_expire_link(*link);
-
-				switch (thread->m_state)
-				{
-				case ThreadImpl::State::Sleeping:
-					m_ready_threads.insert(thread->m_priority_link, thread->m_effective_priority);
-					thread->m_priority_list = &m_ready_threads;
-					thread->m_state = ThreadImpl::State::Ready;
-					break;
-				case ThreadImpl::State::SleepingAndPaused:
-					thread->m_state = ThreadImpl::State::Paused;
-					break;
-				case ThreadImpl::State::SoftBlockedByMessage:
-				case ThreadImpl::State::SoftBlockedByMutex:
-					thread->m_priority_list->remove_link(thread->m_priority_link);
-					m_ready_threads.insert(thread->m_priority_link, thread->m_effective_priority);
-					thread->m_priority_list = &m_ready_threads;
-					thread->m_state = ThreadImpl::State::Ready;
-					break;
-				default:
-					TX_ASSERT(0);
-				}
+				change_one_expired_thread_to_ready(*thread, time);
 
 				link = &link->next();
 			}
@@ -641,9 +974,106 @@ void Scheduler::change_expired_sleeping_thread_to_ready_version_list(TimeType ti
 	}
 }
 
+#endif
+
+void Scheduler::change_expired_precise_thread_to_ready(TimeType core_cycle)
+{
+	while (precise_expiration_is_due(core_cycle))
+	{
+		ThreadImpl & thread = ThreadImpl::get_thread_from_m_expire_link(m_precise_expiration_list.next());
+		thread.m_expire_link.remove_from_cycle();
+		change_one_expired_thread_to_ready(thread, core_cycle);
+	}
+}
+
+void Scheduler::change_one_expired_thread_to_ready(ThreadImpl & thread, TimeType time)
+// The thread has been removed from its expiration list
+{
+	switch (thread.m_state)
+	{
+	case ThreadImpl::State::Sleeping:
+		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+		thread.m_priority_list = &m_ready_threads;
+		thread.m_state = ThreadImpl::State::Ready;
+		break;
+	case ThreadImpl::State::SleepingAndPaused:
+		thread.m_state = ThreadImpl::State::Paused;
+		break;
+	case ThreadImpl::State::SoftBlockedByMessage:
+	case ThreadImpl::State::SoftBlockedByMutex:
+	case ThreadImpl::State::SoftBlockedByPool:
+		thread.m_priority_list->remove_link(thread.m_priority_link);
+		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+		thread.m_priority_list = &m_ready_threads;
+		thread.m_state = ThreadImpl::State::Ready;
+		break;
+	case ThreadImpl::State::SoftBlockedByNotification:
+		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
+		thread.m_priority_list = &m_ready_threads;
+		thread.m_state = ThreadImpl::State::Ready;
+		break;
+	default:
+		TX_ASSERT(0);
+	}
+	RTOS_TRACE_THREAD(State, thread, time.m_time, nullptr);
+}
+
+void Scheduler::insert_precise_expiration(ThreadImpl & thread, TimeType expire_cycle)
+// The list is sorted on insertion, which takes a step per thread waiting for a later core cycle
+{
+	thread.m_expire_time = expire_cycle;
+
+	TXLib::LinkedCycle * iter = &m_precise_expiration_list.prev();
+	while (iter != &m_precise_expiration_list && ThreadImpl::get_thread_from_m_expire_link(*iter).m_expire_time > expire_cycle)
+	{
+		iter = &iter->prev();
+	}
+	thread.m_expire_link.insert_single_as_next_of(*iter);
+}
+
+void Scheduler::insert_soft_block_expiration(ThreadImpl & thread, TimeType expire_time, bool in_cycles)
+/* An expiration in core cycles goes to the precise expiration list, and the tick timer is reprogrammed if it comes before the next tick
+ * An expiration in ticks goes to the structure selected by RTOS_CONFIG_SOFT_BLOCK_LIST. */
+{
+	thread.m_expire_in_cycles = in_cycles;
+	if (in_cycles)
+	{
+		insert_precise_expiration(thread, expire_time);
+		set_timer_interrupt(g_system_timer.get_next_tick_core_cycle());
+		return;
+	}
+
+	thread.m_expire_time = expire_time;
+#if RTOS_CONFIG_SOFT_BLOCK_LIST
+	TX_ASSERT(expire_time > g_system_timer.get_tick());
+	m_expiration_list.insert_thread(thread.m_expire_link, expire_time);
+#else
+	m_expire_heap.insert(thread);
+#endif
+}
+
+void Scheduler::remove_soft_block_expiration(ThreadImpl & thread)
+// For a thread woken up before its expiration; a timer interrupt programmed for it finds nothing due
+{
+	if (thread.m_expire_in_cycles)
+	{
+		thread.m_expire_link.remove_from_cycle();
+		return;
+	}
+
+#if RTOS_CONFIG_SOFT_BLOCK_LIST
+	m_expiration_list.remove(thread.m_expire_link);
+#else
+	bool success = m_expire_heap.remove(thread);
+	tx_assert(success);
+#endif
+}
+
 
 // Heap version
 
+#if !RTOS_CONFIG_SLEEP_LIST
+
 void Scheduler::change_expired_sleeping_thread_to_ready_version_heap(TimeType time)
 {
 	while (m_sleep_heap.get_size() > 0)
@@ -664,9 +1094,14 @@ void Scheduler::change_expired_sleeping_thread_to_ready_version_heap(TimeType ti
 		default:
 			TX_ASSERT(0);
 		}
+		RTOS_TRACE_THREAD(State, thread, time.m_time, nullptr);
 	}
 }
 
+#endif
+
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
+
 void Scheduler::change_expired_softblocked_thread_to_ready_version_heap(TimeType time)
 {
 	while (m_expire_heap.get_size() > 0)
@@ -675,16 +1110,24 @@ void Scheduler::change_expired_softblocked_thread_to_ready_version_heap(TimeType
 		ThreadImpl & thread = *m_expire_heap.pop_top();
 
 		TX_ASSERT(thread.m_state == ThreadImpl::State::SoftBlockedByMessage
-				|| thread.m_state == ThreadImpl::State::SoftBlockedByMutex);
+				|| thread.m_state == ThreadImpl::State::SoftBlockedByMutex
+				|| thread.m_state == ThreadImpl::State::SoftBlockedByPool
+				|| thread.m_state == ThreadImpl::State::SoftBlockedByNotification);
 
 		m_expire_heap.remove(thread);
-		thread.m_priority_list->remove_link(thread.m_priority_link);
+		if (thread.m_priority_list != nullptr) // A thread waiting for a notification is in no priority list
+		{
+			thread.m_priority_list->remove_link(thread.m_priority_link);
+		}
 		m_ready_threads.insert(thread.m_priority_link, thread.m_effective_priority);
 		thread.m_priority_list = &m_ready_threads;
 		thread.m_state = ThreadImpl::State::Ready;
+		RTOS_TRACE_THREAD(State, thread, time.m_time, nullptr);
 	}
 }
 
+#endif
+
 
 
 
@@ -711,14 +1154,16 @@ void Scheduler::change_expired_softblocked_thread_to_ready_version_heap(TimeType
 
 /* Helper functions */
 
-void Scheduler::lock_acquire(void)
+__attribute__((noinline)) void Scheduler::lock_acquire(void) // Not inlined, so that the critical section is attributed to the caller
 {
+	TX_ASSERT(CoreInterrupt::kernel_calls_are_allowed()); // Interrupts above the kernel priority are not masked by the lock
 	m_spinlock.acquire();
+	RTOS_CRITICAL_SECTION_ENTER(__builtin_return_address(0));
 }
 
 void Scheduler::lock_release(void)
 {
-
+	RTOS_CRITICAL_SECTION_EXIT();
 	m_spinlock.release();
 }
 
@@ -726,6 +1171,7 @@ void Scheduler::lock_release(void)
 
 extern "C" size_t Scheduler::idle_thread(size_t arg) // Extern "C" is needed for the linker to find @_estack
 {
+#if !defined(RTOS_PORT_POSIX) // The POSIX port keeps running on the process stack
 	extern uint32_t _estack;
 	__asm volatile(
 			"mov sp, %0 \n" // Reset msp
@@ -735,13 +1181,15 @@ extern "C" size_t Scheduler::idle_thread(size_t arg) // Extern "C" is needed for
 			:
 			: "r"(&_estack), "r"(g_scheduler.m_core.m_thread_running->m_stack_end)
 			: "memory");
+#endif
 
-	CoreInterrupt::enable_systick();
-	CoreInterrupt::trigger_systick_interrupt();
+	TickTimer::enable();
+	TickTimer::trigger_interrupt();
 
 	while (1)
 	{
 		g_scheduler.maintenance_procedure();
+		g_scheduler.stack_scan_procedure();
 		g_scheduler.sleep_procedure();
 	}
 }
@@ -750,9 +1198,10 @@ extern "C" size_t Scheduler::idle_thread(size_t arg) // Extern "C" is needed for
 
 TimeType Scheduler::get_latest_wakeup_time_in_tick(TimeType time_now)
 {
-	constexpr size_t const MAX_TICK_UNTIL_WAKEUP = CoreInterrupt::get_systick_max_countdown_in_core_cycle() / RTOSImpl::CoreCyclePerTick - 1u;
-	TimeType expire_time = time_now + MAX_TICK_UNTIL_WAKEUP; // This number ensures that the SysTick countdown timer does not overflow
+	constexpr size_t const MAX_TICK_UNTIL_WAKEUP = TickTimer::get_max_countdown_in_core_cycle() / RTOSImpl::CoreCyclePerTick - 1u;
+	TimeType expire_time = time_now + MAX_TICK_UNTIL_WAKEUP; // This number ensures that the countdown of the tick timer does not overflow
 
+#if RTOS_CONFIG_EXPIRATION_LIST
 	if (&m_expiration_list.get_next_thread_link() != &m_expiration_list.get_null_link())
 	{
 		ThreadImpl & thread = ThreadImpl::get_thread_from_m_expire_link(m_expiration_list.get_next_thread_link());
@@ -761,29 +1210,65 @@ TimeType Scheduler::get_latest_wakeup_time_in_tick(TimeType time_now)
 			expire_time = thread.m_expire_time - 1;
 		}
 	}
+#endif
 
+#if !RTOS_CONFIG_SLEEP_LIST
 	if (m_sleep_heap.get_size() > 0 && m_sleep_heap.get_top()->m_expire_time - 1 < expire_time)
 	{
 		expire_time = m_sleep_heap.get_top()->m_expire_time - 1;
 	}
+#endif
 
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
 	if (m_expire_heap.get_size() > 0 && m_expire_heap.get_top()->m_expire_time - 1 < expire_time)
 	{
 		expire_time = m_expire_heap.get_top()->m_expire_time - 1;
 	}
+#endif
 
 	return expire_time;
 }
 
+bool Scheduler::precise_expiration_is_due(TimeType core_cycle) const
+// No tolerance, unlike the ticks: a timer interrupt slightly early is followed by another one two timer cycles later (see set_timer_interrupt)
+{
+	return !m_precise_expiration_list.is_single()
+			&& ThreadImpl::get_thread_from_m_expire_link(m_precise_expiration_list.next()).m_expire_time <= core_cycle;
+}
+
+void Scheduler::set_timer_interrupt(TimeType next_systick_time)
+/* Program the tick timer for the next tick, or for the earliest precise expiration if it comes first
+ * An expiration already due is left to deferred_tick_update, as the interrupt would otherwise fire back to back until PendSV runs.
+ * Called with the kernel interrupts masked whenever the earliest precise expiration or the next tick may have changed. */
+{
+	TimeType core_cycle = RTOSImpl::get_rtos_from_m_scheduler(*this).m_system_timer.get_core_cycle_now();
+	TimeType target_cycle = next_systick_time;
+
+	if (precise_expiration_is_due(core_cycle))
+	{
+		m_tick_update_pending = true;
+		switch_context();
+	}
+	else if (!m_precise_expiration_list.is_single())
+	{
+		TimeType expire_cycle = ThreadImpl::get_thread_from_m_expire_link(m_precise_expiration_list.next()).m_expire_time;
+		if (expire_cycle < target_cycle) {target_cycle = expire_cycle;}
+	}
+
+	constexpr size_t const MinCountdown = 2u * TickTimer::CoreCyclePerTimerCycle;
+	TickTimer::reset_counter((target_cycle > core_cycle + MinCountdown) ? target_cycle - core_cycle : MinCountdown);
+}
+
 void Scheduler::maintenance_procedure(void)
+// Sorts the expiration list, if any, in the background
 {
 	TX_ASSERT(__get_PRIMASK() == 0);
 
+#if RTOS_CONFIG_EXPIRATION_LIST
 	bool complete = false;
 	while (!complete)
 	{
-		__disable_irq();
-		__DMB();
+		lock_acquire();
 
 		if (!m_expiration_list.m_unsorted_link.is_single())
 		{
@@ -795,29 +1280,25 @@ void Scheduler::maintenance_procedure(void)
 			complete = true;
 		}
 
-		__DMB();
-		__enable_irq();
+		lock_release();
 	}
+#endif
 }
 
 void Scheduler::sleep_procedure(void)
 {
 	TX_ASSERT(__get_PRIMASK() == 0);
-	__disable_irq();
-	__DMB();
+	lock_acquire();
 
 	SystemTimer & system_timer = RTOSImpl::get_rtos_from_m_scheduler(*this).m_system_timer;
 
-	lock_acquire();
 	TimeType system_time_in_tick = system_timer.get_tick();
 	TimeType wakeup_time_in_tick = get_latest_wakeup_time_in_tick(system_time_in_tick);
-	lock_release();
 
 	if (wakeup_time_in_tick <= system_time_in_tick)
 	{
 		// Abort if there is no time to sleep
-		__DMB();
-		__enable_irq();
+		lock_release();
 		return;
 	}
 
@@ -825,28 +1306,203 @@ void Scheduler::sleep_procedure(void)
 
 	size_t tick_until_wakeup = wakeup_time_in_tick - system_time_in_tick;
 	TimeType wakeup_time_in_cycle = system_timer.get_core_cycle() + tick_until_wakeup * RTOSImpl::CoreCyclePerTick;
-	TX_ASSERT(TimeType(wakeup_time_in_cycle) > CoreClock::get_cycle_count() + (RTOSImpl::CoreCyclePerTick / 2));
-	CoreInterrupt::reset_counter(wakeup_time_in_cycle - TimeType(CoreClock::get_cycle_count()));
+#if !defined(RTOS_PORT_POSIX) // The recorded time may lag behind the host clock (see SystemTimer::update_time)
+	TX_ASSERT(wakeup_time_in_cycle > system_timer.get_core_cycle_now() + (RTOSImpl::CoreCyclePerTick / 2));
+#endif
+	if (!m_precise_expiration_list.is_single())
+	{
+		if (precise_expiration_is_due(system_timer.get_core_cycle_now()))
+		{
+			// Abort as well; the timer interrupt programmed for this expiration is about to fire
+			lock_release();
+			return;
+		}
+
+		TimeType expire_cycle = ThreadImpl::get_thread_from_m_expire_link(m_precise_expiration_list.next()).m_expire_time;
+		if (expire_cycle < wakeup_time_in_cycle) {wakeup_time_in_cycle = expire_cycle;}
+	}
+	TimeType sleep_time_in_cycle = system_timer.get_core_cycle_now();
+	size_t cycle_until_wakeup = wakeup_time_in_cycle - sleep_time_in_cycle;
+	TickTimer::reset_counter(cycle_until_wakeup);
 	system_timer.set_max_allowable_tick(tick_until_wakeup);
 
-	LowPowerState::enter_sleep_mode();
+	size_t sleep_state = IdleGovernor::select_state(cycle_until_wakeup);
+	size_t state_cycle = cycle_until_wakeup - SleepStates::get_exit_latency(sleep_state); // Leave the state early enough to resume on time
+	if (state_cycle > SleepStates::get_max_residency(sleep_state))
+	{
+		state_cycle = SleepStates::get_max_residency(sleep_state); // The idle thread comes back and sleeps again, so the governor does not count the wake-up as premature
+	}
+
+	RTOS_CRITICAL_SECTION_EXIT(); // Interrupts wake the core up, so the sleep itself does not delay them
+	size_t stopped_cycle = SleepStates::enter(sleep_state, state_cycle);
+	RTOS_CRITICAL_SECTION_ENTER(RTOS_CRITICAL_SECTION_HERE());
+
+	if (stopped_cycle != 0)
+	{
+		// The cycle counter and the tick timer were stopped; the idle thread is credited with that time as well
+		system_timer.skip_time(stopped_cycle);
+		m_core.m_idle_thread.m_cpu_cycle_used += stopped_cycle;
+		m_core.m_elapsed_cycles += stopped_cycle;
+	}
+	IdleGovernor::record(sleep_state, state_cycle, system_timer.get_core_cycle_now() - sleep_time_in_cycle);
 
 	TimeType next_systick_time = system_timer.update_time(CoreClock::get_cycle_count());
-	CoreInterrupt::reset_counter(next_systick_time - TimeType(CoreClock::get_cycle_count()));
+	set_timer_interrupt(next_systick_time); // Also wakes the threads of a precise expiration that ended the sleep
 	system_timer.set_max_allowable_tick(1);
-	CoreInterrupt::clear_systick_interrupt();
+	TickTimer::clear_interrupt();
 
-	__DMB();
-	__enable_irq();
+	lock_release();
 }
 
 void Scheduler::switch_context(void)
 {
 	CoreInterrupt::trigger_pendsv_interrupt();
 
-	TX_ASSERT(*((size_t *)m_core.m_thread_on_core->m_stack_begin) == ThreadImpl::StackLimitIdentifier); // Failing means potential stack overflow
+	if (!ThreadImpl::UseMpuStackGuard) // Overflow faults immediately otherwise
+	{
+		TX_ASSERT(*((size_t *)m_core.m_thread_on_core->m_stack_begin) == ThreadImpl::StackLimitIdentifier); // Failing means potential stack overflow
+	}
+}
+
+
+void Scheduler::register_thread(ThreadImpl & thread)
+{
+	lock_acquire();
+	thread.m_thread_link.insert_single_as_prev_of(m_thread_list);
+	RTOS_TRACE_THREAD(Register, thread, reinterpret_cast<void const *>(thread.m_entry), nullptr);
+	lock_release();
+}
+
+void Scheduler::unregister_thread(ThreadImpl & thread)
+{
+	lock_acquire();
+	if (m_stack_scan_thread == &thread)
+	{
+		advance_stack_scan_thread();
+	}
+	thread.m_thread_link.remove_from_cycle();
+	if (m_stack_scan_thread == &thread) // The thread was the only one in the list
+	{
+		m_stack_scan_thread = nullptr;
+	}
+	lock_release();
 }
 
+void Scheduler::advance_stack_scan_thread(void)
+{
+	TXLib::LinkedCycle * link = (m_stack_scan_thread == nullptr) ? &m_thread_list.next() : &m_stack_scan_thread->m_thread_link.next();
+	if (link == &m_thread_list)
+	{
+		link = &link->next();
+	}
+
+	if (link == &m_thread_list)
+	{
+		m_stack_scan_thread = nullptr;
+	}
+	else
+	{
+		m_stack_scan_thread = & ThreadImpl::get_thread_from_m_thread_link(*link);
+		m_stack_scan_address = m_stack_scan_thread->get_usable_stack_begin(); // The guard region (if any) must not be read
+	}
+}
+
+bool Scheduler::scan_stack_step(void)
+/* Examine at most StackScanStepSize bytes of the stack being scanned, from the bottom upwards
+ * Return true if the scan of the thread is complete (the high-water mark of the thread is then up to date)
+ */
+{
+	ThreadImpl * thread = m_stack_scan_thread;
+	if (thread == nullptr || !thread->m_stack_painted)
+	{
+		advance_stack_scan_thread();
+		return true;
+	}
+
+	size_t limit = m_stack_scan_address + StackScanStepSize;
+	bool reach_end = false;
+	if (limit >= thread->m_stack_used_begin)
+	{
+		limit = thread->m_stack_used_begin;
+		reach_end = true;
+	}
+
+	size_t address = m_stack_scan_address;
+	while (address < limit && *((size_t const *) address) == ThreadImpl::StackLimitIdentifier)
+	{
+		address += sizeof(size_t);
+	}
+
+	if (address == limit && !reach_end)
+	{
+		m_stack_scan_address = address;
+		return false;
+	}
+
+	thread->m_stack_used_begin = address; // The first word that does not carry the paint marks the deepest usage so far
+	advance_stack_scan_thread();
+	return true;
+}
+
+void Scheduler::stack_scan_procedure(void)
+/* Update the stack high-water mark of one thread
+ * The scan runs in short steps so that the lock is held only briefly
+ */
+{
+	bool complete = false;
+	while (!complete)
+	{
+		lock_acquire();
+		complete = scan_stack_step();
+		lock_release();
+	}
+}
+
+void Scheduler::update_cpu_cycles(CoreInfo & core)
+/* Credit the cycles elapsed since the last update to the thread on the core (PendSV_Handler does the same on context switches)
+ * The lock must be held
+ */
+{
+#ifdef RTOS_CPU_ACCOUNTING_ENABLE
+	size_t cycle = CoreClock::get_cycle_count();
+	size_t elapsed_cycles = cycle - core.m_last_context_switch_cycle;
+	core.m_last_context_switch_cycle = cycle;
+	core.m_thread_on_core->m_cpu_cycle_used += elapsed_cycles;
+	core.m_elapsed_cycles += elapsed_cycles;
+#endif
+}
+
+void Scheduler::update_load(TimeType time)
+/* Sample the idle share every LoadSamplePeriod ticks and update the load averages
+ * The cycle counters must be up to date and the lock must be held
+ */
+{
+	static_assert(LoadSamplePeriod * 10u == RTOSImpl::TickPerSecond, "LoadAverageWeights assume a sample period of 100 ms");
+
+	size_t sample_count = (size_t) (time - m_load_sample_time) / LoadSamplePeriod;
+	if (sample_count == 0) {return;}
+
+	uint64_t elapsed_cycles = m_core.m_elapsed_cycles - m_load_sample_elapsed_cycles;
+	uint64_t idle_cycles = m_core.m_idle_thread.m_cpu_cycle_used - m_load_sample_idle_cycles;
+	if (elapsed_cycles == 0) {return;}
+
+	m_idle_permille = (idle_cycles * 1000u) / elapsed_cycles;
+	uint32_t busy = ((elapsed_cycles - idle_cycles) << 16) / elapsed_cycles;
+
+	if (sample_count > LoadAverageMaxCatchUp) {sample_count = LoadAverageMaxCatchUp;}
+	for (size_t i = 0; i < LoadAverageCount; i++)
+	{
+		for (size_t j = 0; j < sample_count; j++) // A sleep spanning several periods contributes one sample per period
+		{
+			int32_t difference = (int32_t) busy - (int32_t) m_load_average[i];
+			m_load_average[i] += (difference * (int32_t) LoadAverageWeights[i]) >> 16;
+		}
+	}
+
+	m_load_sample_time += sample_count * LoadSamplePeriod;
+	m_load_sample_elapsed_cycles = m_core.m_elapsed_cycles;
+	m_load_sample_idle_cycles = m_core.m_idle_thread.m_cpu_cycle_used;
+}
 
 void Scheduler::pause_thread_impl(ThreadImpl & thread)
 {
@@ -861,6 +1517,12 @@ void Scheduler::pause_thread_impl(ThreadImpl & thread)
 	case ThreadImpl::State::BlockedByMessage:
 		g_scheduler.change_messageblocked_thread_to_paused(thread);
 		break;
+	case ThreadImpl::State::BlockedByPool:
+		g_scheduler.change_poolblocked_thread_to_paused(thread);
+		break;
+	case ThreadImpl::State::BlockedByNotification:
+		g_scheduler.change_notificationblocked_thread_to_paused(thread);
+		break;
 	case ThreadImpl::State::Sleeping:
 		g_scheduler.change_sleeping_thread_to_sleepingpaused(thread);
 		break;
@@ -888,50 +1550,123 @@ void Scheduler::pause_thread_impl(ThreadImpl & thread)
 
 void Scheduler::initialize(FunctionPtr entry, size_t stack_size, TimeType current_time)
 {
+#if RTOS_CONFIG_EXPIRATION_LIST
 	m_expiration_list.initialize(current_time);
+#endif
+#if !RTOS_CONFIG_SLEEP_LIST
 	m_sleep_heap.initialize();
+#endif
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
 	m_expire_heap.initialize();
+#endif
+	m_stack_scan_thread = nullptr;
+	m_tick_update_pending = false;
 	m_core.initialize();
+	m_load_sample_time = current_time;
+	m_load_sample_elapsed_cycles = 0;
+	m_load_sample_idle_cycles = 0;
+	m_idle_permille = 1000;
+	for (uint32_t & load : m_load_average) {load = 0;}
+	m_cpu_report_elapsed_cycles = 0;
 
 	m_first_user_thread.initialize_self(entry, 0, PriorityList::MAX_PRIORITY, stack_size);
+	RTOS_TRACE_THREAD(Register, m_core.m_idle_thread, nullptr, nullptr); // The decoder names the thread without entry function "idle"
 	change_paused_thread_to_ready(m_first_user_thread);
 
-	LowPowerState::initialize();
+	SleepStates::initialize();
+	IdleGovernor::initialize();
 	CoreInterrupt::initialize();
+	TickTimer::initialize();
+#if defined(__ARM_FP)
+	CoreFpu::initialize();
+#endif
+	if (ThreadImpl::UseMpuStackGuard)
+	{
+		CoreMpu::initialize(m_core.m_idle_thread.m_stack_begin);
+	}
 
 	idle_thread(0); // The main thread becomes the idle thread here
 	TX_ASSERT(0); // Should not reach here
 }
 
 void Scheduler::systick_update(TimeType time)
+/* Timekeeping only; the expirations and the choice of the next thread are deferred to PendSV_Handler (see deferred_tick_update),
+ *  which runs at the lowest priority and performs the context switch that usually follows in the same exception */
 {
 	lock_acquire();
 	RTOS_PROFILER_START("systick_update");
+	RTOS_TRACE_TICK(time);
+
+	update_cpu_cycles(m_core); // Also keeps the 32-bit cycle counter from wrapping between two updates
+	update_load(time);
+
+	if (!m_tick_update_pending && tick_update_is_needed(time))
+	{
+		m_tick_update_pending = true;
+		switch_context();
+	}
+
+	RTOS_PROFILER_STOP("systick_update");
+	lock_release();
+}
+
+bool Scheduler::tick_update_is_needed(TimeType time)
+// O(1): a timed event is due, or a ready thread should preempt the running thread
+{
+	if (get_latest_wakeup_time_in_tick(time) < time || precise_expiration_is_due(g_system_timer.get_core_cycle_now()))
+	{
+		return true;
+	}
+#if RTOS_CONFIG_EXPIRATION_LIST
+	if (m_expiration_list.m_earliest_unsorted_expire_time <= time)
+	{
+		return true;
+	}
+#endif
+
+	size_t running_priority = (m_core.m_thread_running != &m_core.m_idle_thread) ? m_core.m_thread_running->m_effective_priority : PriorityList::INVALID_PRIORITY;
+	return m_ready_threads.get_highest_priority() < running_priority;
+}
 
+void Scheduler::deferred_tick_update(void)
+/* Called by PendSV_Handler with the kernel interrupts masked, before the context switch
+ * It only changes m_thread_running; the context switch in progress then switches to it. */
+{
+	if (!m_tick_update_pending) {return;}
+	m_tick_update_pending = false;
+
+	RTOS_PROFILER_START("deferred_tick_update");
+	SystemTimer & system_timer = RTOSImpl::get_rtos_from_m_scheduler(*this).m_system_timer;
+	TimeType time = system_timer.get_tick();
+
+#if RTOS_CONFIG_EXPIRATION_LIST
 	if (m_expiration_list.m_earliest_unsorted_expire_time <= time)
 	{
 		m_expiration_list.sort_all_unsorted(time);
 	}
+#endif
 
 	change_expired_thread_to_ready(time);
 
+	TimeType core_cycle = system_timer.get_core_cycle_now();
+	if (precise_expiration_is_due(core_cycle))
+	{
+		change_expired_precise_thread_to_ready(core_cycle);
+		set_timer_interrupt(system_timer.get_next_tick_core_cycle()); // For the next precise expiration
+	}
+
 	if (m_core.m_thread_running != &m_core.m_idle_thread)
 	{
-		if (exchange_top_ready_thread_with_running_thread(m_core, m_core.m_thread_running->m_effective_priority))
-		{
-			switch_context();
-		}
+		exchange_top_ready_thread_with_running_thread(m_core, m_core.m_thread_running->m_effective_priority);
 	}
 	else
 	{
 		// Reaching here means that the core is running the idle thread
 		m_core.m_thread_running = nullptr;
 		change_top_ready_thread_to_running(m_core);
-		switch_context();
 	}
 
-	RTOS_PROFILER_STOP("systick_update");
-	lock_release();
+	RTOS_PROFILER_STOP("deferred_tick_update");
 }
 
 void Scheduler::kill_thread(ThreadImpl & thread)
@@ -1018,6 +1753,116 @@ void Scheduler::sleep_until(CoreInfo & core, TimeType expire_time)
 	lock_release();
 }
 
+void Scheduler::sleep_until_cycles(CoreInfo & core, TimeType expire_cycle)
+// As sleep_until, with an expiration time in core cycles; the tick timer is reprogrammed if it comes before the next tick
+{
+	lock_acquire();
+	RTOS_PROFILER_START("sleep");
+
+	if (expire_cycle > RTOSImpl::get_rtos_from_m_scheduler(*this).m_system_timer.get_core_cycle_now())
+	{
+		change_running_thread_to_precisesleeping(core, expire_cycle);
+		set_timer_interrupt(RTOSImpl::get_rtos_from_m_scheduler(*this).m_system_timer.get_next_tick_core_cycle());
+		change_top_ready_thread_to_running(core);
+		switch_context();
+	}
+
+	RTOS_PROFILER_STOP("sleep");
+	lock_release();
+}
+
+void Scheduler::notify_thread(ThreadImpl & thread, NotifyAction action, uint32_t value)
+/* Update the notification word of @thread and make it ready if it waits for a notification; callable in handler mode
+ * A woken thread of higher priority preempts the running thread, or the idle thread, on the next PendSV. */
+{
+	lock_acquire();
+	RTOS_PROFILER_START("notify");
+
+	switch (action)
+	{
+	case NotifyAction::SetBits:
+		thread.m_notification |= value;
+		break;
+	case NotifyAction::Increment:
+		thread.m_notification++;
+		break;
+	case NotifyAction::Overwrite:
+		thread.m_notification = value;
+		break;
+	}
+	thread.m_notification_pending = true;
+
+	if (thread.m_state == ThreadImpl::State::BlockedByNotification || thread.m_state == ThreadImpl::State::SoftBlockedByNotification)
+	{
+		change_notificationblocked_thread_to_ready(thread);
+
+		if (m_core.m_thread_running == &m_core.m_idle_thread)
+		{
+			m_core.m_thread_running = nullptr;
+			change_top_ready_thread_to_running(m_core);
+			switch_context();
+		}
+		else if (exchange_top_ready_thread_with_running_thread(m_core, m_core.m_thread_running->m_effective_priority))
+		{
+			switch_context();
+		}
+	}
+
+	RTOS_PROFILER_STOP("notify");
+	lock_release();
+}
+
+std::pair<uint32_t, bool> Scheduler::wait_notification(CoreInfo & core, uint32_t clear_mask, bool has_expire_time, TimeType expire_time)
+/* Block the thread with state RUNNING on @core until it is notified, or until @expire_time if @has_expire_time
+ * Return the notification word before the bits of @clear_mask are cleared, and whether a notification was taken */
+{
+	ThreadImpl & thread = *core.m_thread_running;
+	uint32_t value = 0;
+
+	enum class State
+	{
+		Waiting,
+		Notified,
+		TimeOut,
+	} state = State::Waiting;
+
+	while (state == State::Waiting)
+	{
+		lock_acquire();
+		RTOS_PROFILER_START("wait_notification");
+
+		if (thread.m_notification_pending)
+		{
+			value = thread.m_notification;
+			thread.m_notification &= ~clear_mask;
+			thread.m_notification_pending = false;
+			state = State::Notified;
+		}
+		else if (has_expire_time && expire_time <= g_system_timer.get_tick())
+		{
+			state = State::TimeOut;
+		}
+		else
+		{
+			if (has_expire_time)
+			{
+				change_running_thread_to_softnotificationblocked(core, expire_time);
+			}
+			else
+			{
+				change_running_thread_to_notificationblocked(core);
+			}
+			change_top_ready_thread_to_running(core);
+			switch_context();
+		}
+
+		RTOS_PROFILER_STOP("wait_notification");
+		lock_release();
+	}
+
+	return std::pair<uint32_t, bool>(value, state == State::Notified);
+}
+
 
 
 
@@ -1097,12 +1942,21 @@ void Mutex::lock(void)
 }
 
 bool Mutex::try_lock(size_t max_wait_time)
+{
+	return try_lock_until(g_system_timer.read_tick() + max_wait_time, false);
+}
+
+bool Mutex::try_lock_until_cycles(TimeType core_cycle)
+{
+	return try_lock_until(core_cycle, true);
+}
+
+bool Mutex::try_lock_until(TimeType expire_time, bool in_cycles)
+// @expire_time is in core cycles if @in_cycles, in ticks otherwise
 {
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
 	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
 
-	TimeType skip_time = g_system_timer.get_tick() + max_wait_time;
-
 	enum class State
 	{
 		Trying,
@@ -1121,7 +1975,7 @@ bool Mutex::try_lock(size_t max_wait_time)
 			TX_ASSERT(m_owner->m_effective_priority <= get_inherited_priority()); // Should not happen during single-core execution; multi-core TODO
 			state = State::Acquired;
 		}
-		else if (skip_time <= g_system_timer.get_tick())
+		else if (expire_time <= (in_cycles ? g_system_timer.get_core_cycle_now() : g_system_timer.get_tick()))
 		{
 			state = State::TimeOut;
 		}
@@ -1129,7 +1983,7 @@ bool Mutex::try_lock(size_t max_wait_time)
 		{
 			TX_Assert(m_owner != g_scheduler.m_core.m_thread_running); // Re-acquiring an acquired lock is forbidden
 
-			g_scheduler.change_running_thread_to_softmutexblocked(g_scheduler.m_core, *this, skip_time);
+			g_scheduler.change_running_thread_to_softmutexblocked(g_scheduler.m_core, *this, expire_time, in_cycles);
 			g_scheduler.change_top_ready_thread_to_running(g_scheduler.m_core);
 			g_scheduler.switch_context();
 		}
@@ -1182,6 +2036,9 @@ size_t MessageQueue::pull(void)
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
 	TX_ASSERT(is_initialized());
 
+	ThreadImpl & thread = *g_scheduler.m_core.m_thread_on_core;
+	thread.m_message_handed_off = false;
+
 	size_t message;
 	bool success = false;
 	while (!success)
@@ -1189,7 +2046,12 @@ size_t MessageQueue::pull(void)
 		g_scheduler.lock_acquire();
 		RTOS_PROFILER_START("msgqueue_pull");
 
-		if (!m_queue.is_empty())
+		if (thread.m_message_handed_off)
+		{
+			message = thread.m_handed_off_message;
+			success = true;
+		}
+		else if (!m_queue.is_empty())
 		{
 			message = m_queue.pop_front();
 			success = true;
@@ -1208,11 +2070,23 @@ size_t MessageQueue::pull(void)
 }
 
 std::pair<size_t, bool> MessageQueue::try_pull(size_t max_wait_time)
+{
+	return try_pull_until(g_system_timer.read_tick() + max_wait_time, false);
+}
+
+std::pair<size_t, bool> MessageQueue::try_pull_until_cycles(TimeType core_cycle)
+{
+	return try_pull_until(core_cycle, true);
+}
+
+std::pair<size_t, bool> MessageQueue::try_pull_until(TimeType expire_time, bool in_cycles)
+// @expire_time is in core cycles if @in_cycles, in ticks otherwise
 {
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
 	TX_ASSERT(is_initialized());
 
-	TimeType skip_time = g_system_timer.get_tick() + max_wait_time;
+	ThreadImpl & thread = *g_scheduler.m_core.m_thread_on_core;
+	thread.m_message_handed_off = false;
 	size_t message;
 
 	enum class State
@@ -1227,18 +2101,23 @@ std::pair<size_t, bool> MessageQueue::try_pull(size_t max_wait_time)
 		g_scheduler.lock_acquire();
 		RTOS_PROFILER_START("msgqueue_try_pull");
 
-		if (!m_queue.is_empty())
+		if (thread.m_message_handed_off) // Takes precedence over the expiration, which may have passed by the time the thread runs
+		{
+			message = thread.m_handed_off_message;
+			state = State::Acquired;
+		}
+		else if (!m_queue.is_empty())
 		{
 			message = m_queue.pop_front();
 			state = State::Acquired;
 		}
-		else if (skip_time <= g_system_timer.get_tick())
+		else if (expire_time <= (in_cycles ? g_system_timer.get_core_cycle_now() : g_system_timer.get_tick()))
 		{
 			state = State::TimeOut;
 		}
 		else
 		{
-			g_scheduler.change_running_thread_to_softmessageblocked(g_scheduler.m_core, *this, skip_time);
+			g_scheduler.change_running_thread_to_softmessageblocked(g_scheduler.m_core, *this, expire_time, in_cycles);
 			g_scheduler.change_top_ready_thread_to_running(g_scheduler.m_core);
 			g_scheduler.switch_context();
 		}
@@ -1251,6 +2130,7 @@ std::pair<size_t, bool> MessageQueue::try_pull(size_t max_wait_time)
 }
 
 bool MessageQueue::push(size_t message)
+/* A message for a blocked thread is handed off to it rather than queued: the queue is empty in that case, and the thread would pop it first anyway. */
 {
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
 	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
@@ -1261,28 +2141,341 @@ bool MessageQueue::push(size_t message)
 	g_scheduler.lock_acquire();
 	RTOS_PROFILER_START("msgqueue_push");
 
-	if (m_queue.is_full())
+	if (g_scheduler.hand_off_message_to_top_messageblocked_thread(g_scheduler.m_core, *this, message))
+	{
+		if (g_scheduler.m_core.m_thread_running != g_scheduler.m_core.m_thread_on_core)
+		{
+			g_scheduler.switch_context();
+		}
+		success = true;
+	}
+	else if (m_queue.is_full())
 	{
 		success = false;
 	}
 	else
 	{
 		m_queue.push_back(message);
+		success = true;
+	}
 
-		g_scheduler.change_top_messageblocked_thread_to_ready(*this);
+	RTOS_PROFILER_STOP("msgqueue_push");
+	g_scheduler.lock_release();
+
+	return success;
+}
 
-		if (g_scheduler.exchange_top_ready_thread_with_running_thread(g_scheduler.m_core, g_scheduler.m_core.m_thread_running->m_effective_priority))
+
+
+bool MemoryPool::initialize(size_t block_size, size_t block_count)
+{
+	size_t buffer_size = get_buffer_size(block_size, block_count);
+	void * buffer = RTOS::alloc(buffer_size);
+	if (buffer == nullptr) {return false;}
+
+	initialize(buffer, buffer_size, block_size);
+	m_owns_buffer = true;
+	return true;
+}
+
+void MemoryPool::initialize(void * buffer, size_t buffer_size, size_t block_size)
+{
+	TX_ASSERT(!is_initialized());
+	TX_ASSERT(((size_t) buffer & (BlockAlignment - 1u)) == 0);
+
+	m_buffer = static_cast<char *>(buffer);
+	m_block_size = get_rounded_block_size(block_size);
+	m_block_count = buffer_size / m_block_size;
+	m_owns_buffer = false;
+	TX_ASSERT(m_block_count > 0);
+
+	m_free_blocks = nullptr;
+	for (size_t i = m_block_count; i > 0; i--) // The first allocations return the lowest addresses
+	{
+		FreeBlock * block = reinterpret_cast<FreeBlock *>(m_buffer + (i - 1u) * m_block_size);
+		block->m_next = m_free_blocks;
+		m_free_blocks = block;
+	}
+	m_free_count = m_block_count;
+	m_min_free_count = m_block_count;
+}
+
+void MemoryPool::uninitialize(void)
+{
+	TX_ASSERT(m_free_count == m_block_count);
+	TX_ASSERT(m_blocked_threads.get_highest_priority() == PriorityList::INVALID_PRIORITY);
+
+	if (m_owns_buffer)
+	{
+		RTOS::free(m_buffer);
+	}
+	m_buffer = nullptr;
+	m_free_blocks = nullptr;
+	m_block_count = 0;
+	m_free_count = 0;
+}
+
+void * MemoryPool::pop_block(void)
+// The kernel lock must be held and a block must be free
+{
+	FreeBlock * block = m_free_blocks;
+	m_free_blocks = block->m_next;
+	m_free_count--;
+	if (m_free_count < m_min_free_count)
+	{
+		m_min_free_count = m_free_count;
+	}
+	return block;
+}
+
+bool MemoryPool::contains(void const * block) const
+{
+	size_t offset = (size_t) block - (size_t) m_buffer;
+	return offset < m_block_count * m_block_size && offset % m_block_size == 0;
+}
+
+void * MemoryPool::alloc(void)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(is_initialized());
+
+	void * block = nullptr;
+	while (block == nullptr)
+	{
+		g_scheduler.lock_acquire();
+		RTOS_PROFILER_START("mempool_alloc");
+
+		if (m_free_blocks != nullptr)
 		{
+			block = pop_block();
+		}
+		else
+		{
+			g_scheduler.change_running_thread_to_poolblocked(g_scheduler.m_core, *this);
+			g_scheduler.change_top_ready_thread_to_running(g_scheduler.m_core);
 			g_scheduler.switch_context();
 		}
 
-		success = true;
+		RTOS_PROFILER_STOP("mempool_alloc");
+		g_scheduler.lock_release();
 	}
+	return block;
+}
 
-	RTOS_PROFILER_STOP("msgqueue_push");
+void * MemoryPool::try_alloc(size_t max_wait_time)
+{
+	return try_alloc_until(g_system_timer.read_tick() + max_wait_time, false);
+}
+
+void * MemoryPool::try_alloc_until_cycles(TimeType core_cycle)
+{
+	return try_alloc_until(core_cycle, true);
+}
+
+void * MemoryPool::try_alloc_until(TimeType expire_time, bool in_cycles)
+// @expire_time is in core cycles if @in_cycles, in ticks otherwise
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(is_initialized());
+
+	void * block = nullptr;
+	bool timeout = false;
+
+	while (block == nullptr && !timeout)
+	{
+		g_scheduler.lock_acquire();
+		RTOS_PROFILER_START("mempool_try_alloc");
+
+		if (m_free_blocks != nullptr)
+		{
+			block = pop_block();
+		}
+		else if (expire_time <= (in_cycles ? g_system_timer.get_core_cycle_now() : g_system_timer.get_tick()))
+		{
+			timeout = true;
+		}
+		else
+		{
+			g_scheduler.change_running_thread_to_softpoolblocked(g_scheduler.m_core, *this, expire_time, in_cycles);
+			g_scheduler.change_top_ready_thread_to_running(g_scheduler.m_core);
+			g_scheduler.switch_context();
+		}
+
+		RTOS_PROFILER_STOP("mempool_try_alloc");
+		g_scheduler.lock_release();
+	}
+
+	return block;
+}
+
+void MemoryPool::free(void * block)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
+	TX_ASSERT(contains(block));
+
+	g_scheduler.lock_acquire();
+	RTOS_PROFILER_START("mempool_free");
+
+	FreeBlock * free_block = static_cast<FreeBlock *>(block);
+	free_block->m_next = m_free_blocks;
+	m_free_blocks = free_block;
+	m_free_count++;
+	TX_ASSERT(m_free_count <= m_block_count); // Failing means a block was freed twice
+
+	g_scheduler.change_top_poolblocked_thread_to_ready(*this);
+
+	if (g_scheduler.exchange_top_ready_thread_with_running_thread(g_scheduler.m_core, g_scheduler.m_core.m_thread_running->m_effective_priority))
+	{
+		g_scheduler.switch_context();
+	}
+
+	RTOS_PROFILER_STOP("mempool_free");
 	g_scheduler.lock_release();
+}
 
-	return success;
+
+
+void Arena::initialize(size_t chunk_size)
+{
+	TX_ASSERT(!is_initialized());
+	TX_ASSERT(chunk_size > 0);
+
+	m_first_chunk = nullptr;
+	m_chunk = nullptr;
+	m_top = nullptr;
+	m_end = nullptr;
+	m_chunk_size = (chunk_size + Alignment - 1u) & ~(Alignment - 1u);
+	m_used_size = 0;
+}
+
+void Arena::uninitialize(void)
+{
+	if (!is_initialized()) {return;}
+
+	unbind();
+	m_chunk = nullptr;
+	trim();
+	m_top = nullptr;
+	m_end = nullptr;
+	m_chunk_size = 0;
+	m_used_size = 0;
+}
+
+void Arena::bind(void)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(is_initialized());
+	TX_ASSERT(m_thread == nullptr);
+
+	ThreadImpl & thread = *g_scheduler.m_core.m_thread_on_core;
+	m_thread = &thread;
+	m_next_bound = thread.m_bound_arenas;
+	thread.m_bound_arenas = this;
+}
+
+void Arena::unbind(void)
+{
+	if (m_thread == nullptr) {return;}
+
+	ThreadImpl & thread = *reinterpret_cast<ThreadImpl *>(m_thread);
+	Arena ** link = &thread.m_bound_arenas;
+	while (*link != this)
+	{
+		TX_ASSERT(*link != nullptr);
+		link = &(*link)->m_next_bound;
+	}
+	*link = m_next_bound;
+	m_thread = nullptr;
+	m_next_bound = nullptr;
+}
+
+void Arena::release_bound_arenas(Thread & thread)
+{
+	ThreadImpl & thread_impl = *reinterpret_cast<ThreadImpl *>(&thread);
+	while (thread_impl.m_bound_arenas != nullptr)
+	{
+		thread_impl.m_bound_arenas->uninitialize();
+	}
+}
+
+bool Arena::move_to_next_chunk(size_t size)
+// Continue in the next spare chunk if it fits @size, otherwise insert a new chunk before it
+{
+	Chunk * next_chunk = (m_chunk != nullptr) ? m_chunk->m_next : m_first_chunk;
+	if (next_chunk == nullptr || next_chunk->m_size < size)
+	{
+		size_t chunk_size = (size > m_chunk_size) ? size : m_chunk_size;
+		Chunk * new_chunk = static_cast<Chunk *>(RTOS::alloc(sizeof(Chunk) + chunk_size));
+		if (new_chunk == nullptr) {return false;}
+
+		new_chunk->m_next = next_chunk;
+		new_chunk->m_size = chunk_size;
+		if (m_chunk != nullptr) {m_chunk->m_next = new_chunk;} else {m_first_chunk = new_chunk;}
+		next_chunk = new_chunk;
+	}
+
+	if (m_chunk != nullptr) {m_used_size += m_chunk->m_size;}
+	m_chunk = next_chunk;
+	m_top = reinterpret_cast<char *>(m_chunk + 1);
+	m_end = m_top + m_chunk->m_size;
+	return true;
+}
+
+void * Arena::alloc(size_t size)
+{
+	TX_ASSERT(is_initialized());
+
+	size = (size + Alignment - 1u) & ~(Alignment - 1u);
+	if ((size_t) (m_end - m_top) < size)
+	{
+		if (!move_to_next_chunk(size)) {return nullptr;}
+	}
+
+	void * block = m_top;
+	m_top += size;
+	return block;
+}
+
+void Arena::release(Mark const & mark)
+{
+	TX_ASSERT(is_initialized());
+
+	m_chunk = static_cast<Chunk *>(mark.chunk);
+	m_top = mark.top;
+	m_used_size = mark.used_size;
+	if (m_chunk != nullptr)
+	{
+		m_end = reinterpret_cast<char *>(m_chunk + 1) + m_chunk->m_size;
+		TX_ASSERT(m_top >= reinterpret_cast<char *>(m_chunk + 1) && m_top <= m_end); // Failing means that the mark was taken from another arena
+	}
+	else
+	{
+		m_end = nullptr;
+	}
+}
+
+void Arena::reset(void)
+{
+	release(Mark{nullptr, nullptr, 0});
+}
+
+void Arena::trim(void)
+{
+	Chunk * chunk = (m_chunk != nullptr) ? m_chunk->m_next : m_first_chunk;
+	while (chunk != nullptr)
+	{
+		Chunk * next_chunk = chunk->m_next;
+		RTOS::free(chunk);
+		chunk = next_chunk;
+	}
+
+	if (m_chunk != nullptr) {m_chunk->m_next = nullptr;} else {m_first_chunk = nullptr;}
+}
+
+size_t Arena::get_used_size(void) const
+{
+	return (m_chunk != nullptr) ? m_used_size + (size_t) (m_top - reinterpret_cast<char *>(m_chunk + 1)) : 0;
 }
 
 
@@ -1302,10 +2495,26 @@ void Thread::initialize(FunctionPtr entry, size_t entry_argument, size_t priorit
 	g_scheduler.lock_release();
 }
 
+void Thread::initialize(FunctionPtr entry, size_t entry_argument, size_t priority, void * stack_ptr, size_t stack_size)
+{
+	ThreadImpl & thread = *reinterpret_cast<ThreadImpl *>(this);
+	thread.initialize_self(entry, entry_argument, priority, stack_ptr, stack_size);
+
+	g_scheduler.lock_acquire();
+	g_scheduler.change_paused_thread_to_ready(thread);
+	g_scheduler.lock_release();
+}
+
 void Thread::uninitialize(void)
 {
 	TX_ASSERT(m_state == State::Terminated);
-	free((void*) m_stack_begin);
+	g_scheduler.unregister_thread(*reinterpret_cast<ThreadImpl *>(this));
+	Arena::release_bound_arenas(*this); // Killed threads still hold their arenas and their cache
+	g_rtos.release_alloc_cache(*reinterpret_cast<ThreadImpl *>(this));
+	if (m_owns_stack)
+	{
+		free((void*) m_stack_begin);
+	}
 	m_state = State::Reset; // In this state, the thread does not have ownership of any stack memory
 }
 
@@ -1314,10 +2523,36 @@ Thread::~Thread(void)
 	TX_ASSERT(m_state == State::Reset || m_state == State::Terminated);
 	if (m_state == State::Terminated)
 	{
-		free((void*) m_stack_begin);
+		g_scheduler.unregister_thread(*reinterpret_cast<ThreadImpl *>(this));
+		Arena::release_bound_arenas(*this);
+		g_rtos.release_alloc_cache(*reinterpret_cast<ThreadImpl *>(this));
+		if (m_owns_stack)
+		{
+			free((void*) m_stack_begin);
+		}
 	}
 }
 
+uint64_t Thread::get_cpu_cycles(void) const
+{
+	g_scheduler.lock_acquire();
+	g_scheduler.update_cpu_cycles(g_scheduler.m_core);
+	uint64_t cpu_cycles = m_cpu_cycle_used;
+	g_scheduler.lock_release();
+
+	return cpu_cycles;
+}
+
+size_t Thread::get_recommended_stack_size(void) const
+{
+	size_t peak_usage = get_stack_peak_usage();
+	if (peak_usage == 0) {return 0;}
+
+	size_t recommended_size = peak_usage + peak_usage / 4 // 25% margin
+			+ (ThreadImpl::UseMpuStackGuard ? 2 * CoreMpu::StackGuardSize - 8u : sizeof(size_t)); // Guard region with worst-case alignment, or the stack limit identifier
+	return (recommended_size + 0b111) & ~(size_t) 0b111;
+}
+
 void relinquish(void)
 {
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
@@ -1331,7 +2566,114 @@ void sleep(size_t sleep_duration)
 	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
 	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
 
-	g_scheduler.sleep_until(g_scheduler.m_core, g_system_timer.get_tick() + sleep_duration);
+	g_scheduler.sleep_until(g_scheduler.m_core, g_system_timer.read_tick() + sleep_duration);
+}
+
+void sleep_for_us(size_t sleep_duration_us)
+{
+	sleep_until_cycles(system_time_in_cycles() + (uint64_t) sleep_duration_us * RTOSImpl::CoreCyclePerMicrosecond);
+}
+
+void sleep_until_cycles(TimeType core_cycle)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
+
+	g_scheduler.sleep_until_cycles(g_scheduler.m_core, core_cycle);
+}
+
+uint32_t wait_notification(uint32_t clear_mask)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
+
+	return g_scheduler.wait_notification(g_scheduler.m_core, clear_mask, false, 0).first;
+}
+
+std::pair<uint32_t, bool> try_wait_notification(uint32_t clear_mask, size_t max_wait_time)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+	TX_ASSERT(g_scheduler.m_core.m_thread_running == g_scheduler.m_core.m_thread_on_core);
+
+	return g_scheduler.wait_notification(g_scheduler.m_core, clear_mask, true, g_system_timer.read_tick() + max_wait_time);
+}
+
+void set_heap_tag(size_t tag)
+{
+	TX_ASSERT(__get_CONTROL() & 0x10b); // Cannot be called in handler mode
+
+	g_scheduler.m_core.m_thread_on_core->m_heap_tag = tag;
+}
+
+void set_stack_painting(bool enable)
+{
+	ThreadImpl::s_paint_stack = enable;
+}
+
+size_t get_stack_usage_report(StackUsage * report, size_t capacity)
+{
+	size_t count = 0;
+
+	g_scheduler.lock_acquire();
+	TXLib::LinkedCycle * link = &g_scheduler.m_thread_list.next();
+	while (link != &g_scheduler.m_thread_list)
+	{
+		ThreadImpl & thread = ThreadImpl::get_thread_from_m_thread_link(*link);
+		if (count < capacity)
+		{
+			report[count].thread = &thread;
+			report[count].stack_size = thread.get_stack_size();
+			report[count].peak_usage = thread.get_stack_peak_usage();
+			report[count].recommended_size = thread.get_recommended_stack_size();
+		}
+		count++;
+		link = &link->next();
+	}
+	g_scheduler.lock_release();
+
+	return count;
+}
+
+size_t get_cpu_usage_report(CpuUsage * report, size_t capacity)
+{
+	size_t count = 0;
+
+	g_scheduler.lock_acquire();
+	g_scheduler.update_cpu_cycles(g_scheduler.m_core);
+	uint64_t window_cycles = g_scheduler.m_core.m_elapsed_cycles - g_scheduler.m_cpu_report_elapsed_cycles;
+	g_scheduler.m_cpu_report_elapsed_cycles = g_scheduler.m_core.m_elapsed_cycles;
+
+	TXLib::LinkedCycle * link = &g_scheduler.m_thread_list.next();
+	while (link != &g_scheduler.m_thread_list)
+	{
+		ThreadImpl & thread = ThreadImpl::get_thread_from_m_thread_link(*link);
+		if (count < capacity)
+		{
+			report[count].thread = &thread;
+			report[count].cpu_cycles = thread.m_cpu_cycle_used;
+			report[count].usage_permille = window_cycles == 0 ? 0 : ((thread.m_cpu_cycle_used - thread.m_cpu_cycle_reported) * 1000u) / window_cycles;
+		}
+		thread.m_cpu_cycle_reported = thread.m_cpu_cycle_used;
+		count++;
+		link = &link->next();
+	}
+	g_scheduler.lock_release();
+
+	return count;
+}
+
+void get_system_load(SystemLoad & load)
+{
+	g_scheduler.lock_acquire();
+	g_scheduler.update_cpu_cycles(g_scheduler.m_core);
+	load.elapsed_cycles = g_scheduler.m_core.m_elapsed_cycles;
+	load.idle_cycles = g_scheduler.m_core.m_idle_thread.m_cpu_cycle_used;
+	load.idle_permille = g_scheduler.m_idle_permille;
+	for (size_t i = 0; i < LoadAverageCount; i++)
+	{
+		load.load_permille[i] = (g_scheduler.m_load_average[i] * 1000u + (1u << 15)) >> 16;
+	}
+	g_scheduler.lock_release();
 }
 
 void Thread::pause(void)
@@ -1344,6 +2686,24 @@ void Thread::kill(void)
 	g_scheduler.kill_thread(*reinterpret_cast<ThreadImpl *>(this));
 }
 
+void Thread::notify_bits(uint32_t bits)
+{
+	TX_ASSERT(is_initialized());
+	g_scheduler.notify_thread(*reinterpret_cast<ThreadImpl *>(this), Scheduler::NotifyAction::SetBits, bits);
+}
+
+void Thread::notify_increment(void)
+{
+	TX_ASSERT(is_initialized());
+	g_scheduler.notify_thread(*reinterpret_cast<ThreadImpl *>(this), Scheduler::NotifyAction::Increment, 0);
+}
+
+void Thread::notify_overwrite(uint32_t value)
+{
+	TX_ASSERT(is_initialized());
+	g_scheduler.notify_thread(*reinterpret_cast<ThreadImpl *>(this), Scheduler::NotifyAction::Overwrite, value);
+}
+
 void Thread::unpause(void)
 {
 	g_scheduler.unpause_thread(*reinterpret_cast<ThreadImpl *>(this));
@@ -8,12 +8,13 @@
 #pragma once
 
 #include "rtos_thread_impl.hpp"
+#include "rtos_config.hpp"
 #include "./Source/PublicApi/rtos.hpp"
 #include <atomic>
 #include "./External/MyLib/tx_heap.hpp"
 #include "./External/MyLib/tx_array.hpp"
-#include "./External/MyLib/tx_spinlock.hpp"
 #include "./External/MyLib/tx_linkedlist.hpp"
+#include "./Source/Driver/rtos_port.hpp"
 
 
 namespace RTOS
@@ -22,6 +23,12 @@ namespace RTOS
 
 class CoreInfo
 {
+public:
+#if defined(RTOS_PORT_POSIX)
+	static constexpr size_t const IdleStackSize = 0x1000; // Only holds the saved ucontext_t; the idle thread runs on the process stack
+#else
+	static constexpr size_t const IdleStackSize = 0x100;
+#endif
 
 public:
 	ThreadImpl *		m_thread_running; // Thread whose state in the scheduler is RUNNING (its context may not yet be on the core)
@@ -30,7 +37,10 @@ public:
 
 	ThreadImpl			m_idle_thread;	// The idle thread this core executes when there is no job remaining (the scheduler does not register this thread)
 
-	size_t					m_last_context_switch_cycle;
+	size_t					m_last_context_switch_cycle; // Cycle count up to which the cycles are credited to m_thread_on_core
+	uint64_t				m_elapsed_cycles; // Core cycles credited to the threads of this core since initialization
+
+	alignas(8) char	m_idle_stack[IdleStackSize]; // Stack of the idle thread (kept here so that no allocation is needed)
 
 public:
 	CoreInfo(void) noexcept = default;
@@ -147,20 +157,49 @@ public:
 
 class Scheduler // Determines which thread to run; does not own the threads
 {
-	static constexpr bool const UseListVersionForThreadSleep = true;
-	static constexpr bool const UseListVersionForSoftBlockExpiration = true;
+	static constexpr size_t const StackScanStepSize = 0x40; // Number of bytes examined by the idle thread per step of the stack scan (bounds the time spent with the lock held)
+	static constexpr size_t const LoadSamplePeriod = 100; // In ticks
+	static constexpr uint32_t const LoadAverageWeights[LoadAverageCount] = {6236, 652, 109}; // 1 - exp(-LoadSamplePeriod / T) in Q16, for T = 1 s, 10 s and 60 s
+	static constexpr size_t const LoadAverageMaxCatchUp = 64; // Bounds the averaging work when a tickless sleep spans several sample periods
+
+public:
+	enum class NotifyAction
+	{
+		SetBits,
+		Increment,
+		Overwrite,
+	};
 
 public:
 
 	CoreInfo						m_core;		// Running thread
 	PriorityList				m_ready_threads; // Contains all waiting threads
+#if RTOS_CONFIG_EXPIRATION_LIST
 	ExpirationList			m_expiration_list; // Contains threads with timed events (wakeup, try_lock expiration, etc.)
+#endif
+#if !RTOS_CONFIG_SLEEP_LIST
 	SleepHeap						m_sleep_heap;
+#endif
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
 	ExpireHeap					m_expire_heap;
+#endif
+	TXLib::LinkedCycle	m_precise_expiration_list; // Threads whose expiration time is in core cycles rather than ticks, sorted by it
 
 	ThreadImpl					m_first_user_thread;
 
-	Spinlock						m_spinlock;
+	TXLib::LinkedCycle	m_thread_list; // Contains all initialized threads (including the idle thread)
+	ThreadImpl *				m_stack_scan_thread; // Thread whose stack is being scanned by the idle thread
+	size_t							m_stack_scan_address; // Next stack address to be examined
+
+	KernelSpinlock			m_spinlock;
+	bool volatile				m_tick_update_pending; // Set by systick_update, cleared by deferred_tick_update in PendSV_Handler
+
+	TimeType						m_load_sample_time; // Tick of the last load sample
+	uint64_t						m_load_sample_elapsed_cycles;
+	uint64_t						m_load_sample_idle_cycles;
+	size_t							m_idle_permille;
+	uint32_t						m_load_average[LoadAverageCount]; // Busy share in Q16
+	uint64_t						m_cpu_report_elapsed_cycles; // m_core.m_elapsed_cycles at the last get_cpu_usage_report
 
 
 public:
@@ -189,28 +228,48 @@ public:
 	bool exchange_top_ready_thread_with_running_thread(CoreInfo & core, size_t skip_priority);
 	void change_running_thread_to_ready(CoreInfo & core);
 	void change_running_thread_to_sleeping(CoreInfo & core, TimeType expire_time);
+	void change_running_thread_to_precisesleeping(CoreInfo & core, TimeType expire_cycle);
 	void change_running_thread_to_mutexblocked(CoreInfo & core, Mutex & blocking_mutex);
-	void change_running_thread_to_softmutexblocked(CoreInfo & core, Mutex & blocking_mutex, TimeType expire_time);
+	void change_running_thread_to_softmutexblocked(CoreInfo & core, Mutex & blocking_mutex, TimeType expire_time, bool in_cycles);
 	void change_running_thread_to_messageblocked(CoreInfo & core, MessageQueue & queue);
-	void change_running_thread_to_softmessageblocked(CoreInfo & core, MessageQueue & queue, TimeType expire_time);
+	void change_running_thread_to_softmessageblocked(CoreInfo & core, MessageQueue & queue, TimeType expire_time, bool in_cycles);
+	void change_running_thread_to_poolblocked(CoreInfo & core, MemoryPool & pool);
+	void change_running_thread_to_softpoolblocked(CoreInfo & core, MemoryPool & pool, TimeType expire_time, bool in_cycles);
+	void change_running_thread_to_notificationblocked(CoreInfo & core);
+	void change_running_thread_to_softnotificationblocked(CoreInfo & core, TimeType expire_time);
 	void change_running_thread_to_paused(CoreInfo & core);
 	void change_running_thread_to_terminated(CoreInfo & core);
 	void change_expired_thread_to_ready(TimeType time);
+	void change_expired_precise_thread_to_ready(TimeType core_cycle);
 	void change_sleeping_thread_to_sleepingpaused(ThreadImpl & thread);
 	void change_sleepingpaused_thread_to_sleeping(ThreadImpl & thread);
 	void change_top_mutexblocked_thread_to_ready(Mutex & mutex);
 	void change_mutexblocked_thread_to_paused(ThreadImpl & thread);
-	void change_top_messageblocked_thread_to_ready(MessageQueue & queue);
+	bool hand_off_message_to_top_messageblocked_thread(CoreInfo & core, MessageQueue & queue, size_t message);
 	void change_messageblocked_thread_to_paused(ThreadImpl & thread);
+	void change_top_poolblocked_thread_to_ready(MemoryPool & pool);
+	void change_poolblocked_thread_to_paused(ThreadImpl & thread);
+	void change_notificationblocked_thread_to_ready(ThreadImpl & thread);
+	void change_notificationblocked_thread_to_paused(ThreadImpl & thread);
 
 // Thread state-change primitives (helper functions)
 
 	void set_effective_priority(ThreadImpl & thread, size_t priority);
 	void increase_priority_of_blocking_mutexes_and_owners(Mutex * blocking_mutex, size_t priority);
 
+#if RTOS_CONFIG_EXPIRATION_LIST
 	void change_expired_sleeping_thread_to_ready_version_list(TimeType time);
+#endif
+#if !RTOS_CONFIG_SLEEP_LIST
 	void change_expired_sleeping_thread_to_ready_version_heap(TimeType time);
+#endif
+#if !RTOS_CONFIG_SOFT_BLOCK_LIST
 	void change_expired_softblocked_thread_to_ready_version_heap(TimeType time);
+#endif
+	void change_one_expired_thread_to_ready(ThreadImpl & thread, TimeType time);
+	void insert_precise_expiration(ThreadImpl & thread, TimeType expire_cycle);
+	void insert_soft_block_expiration(ThreadImpl & thread, TimeType expire_time, bool in_cycles);
+	void remove_soft_block_expiration(ThreadImpl & thread);
 
 
 
@@ -221,21 +280,35 @@ public:
 	void lock_release(void);
 
 	TimeType get_latest_wakeup_time_in_tick(TimeType time_now);
+	bool precise_expiration_is_due(TimeType core_cycle) const;
+	void set_timer_interrupt(TimeType next_systick_time);
 	void maintenance_procedure(void);
 	void sleep_procedure(void);
 	void switch_context(void);
 	void pause_thread_impl(ThreadImpl & thread);
+	void register_thread(ThreadImpl & thread);
+	void unregister_thread(ThreadImpl & thread);
+	void advance_stack_scan_thread(void);
+	bool scan_stack_step(void);
+	void stack_scan_procedure(void);
+	void update_cpu_cycles(CoreInfo & core);
+	void update_load(TimeType time);
+	bool tick_update_is_needed(TimeType time);
 
 
 // High-level API
 
 	__attribute__((noreturn)) void initialize(FunctionPtr entry, size_t stack_size, TimeType current_time);
 	void systick_update(TimeType time);
+	void deferred_tick_update(void);
 	inline void kill_thread(ThreadImpl & thread);
 	inline void pause_thread(ThreadImpl & thread);
 	inline void unpause_thread(ThreadImpl & thread);
 	inline void relinquish(CoreInfo & core);
 	inline void sleep_until(CoreInfo & core, TimeType expire_time);
+	inline void sleep_until_cycles(CoreInfo & core, TimeType expire_cycle);
+	inline void notify_thread(ThreadImpl & thread, NotifyAction action, uint32_t value);
+	inline std::pair<uint32_t, bool> wait_notification(CoreInfo & core, uint32_t clear_mask, bool has_expire_time, TimeType expire_time);
 
 
 public:
@@ -8,7 +8,7 @@
 #include "rtos_system_timer.hpp"
 #include "rtos_impl.hpp"
 #include "rtos_scheduler.hpp"
-#include "./Source/Driver/cortexm3_core.hpp"
+#include "./Source/Driver/rtos_port.hpp"
 #include "./External/MyLib/tx_arithmetic.hpp"
 #include "./External/MyLib/tx_assert.h"
 
@@ -20,22 +20,109 @@ void SystemTimer::initialize(void)
 {
 	m_last_recorded_tick = 0;
 	m_last_recorded_core_cycle = 0;
+	m_last_update_core_cycle = 0;
+	m_last_update_core_cycle_count = 0; // The cycle counter was just reset by CoreClock::initialize
 	m_max_allowable_tick_until_next_update = TimeType::get_max_positive();
+	m_generation = 0;
+	publish();
 }
 
-TimeType SystemTimer::update_time(TimeType core_cycle)
+TimeType SystemTimer::update_time(size_t core_cycle_count)
 /* Return the number of cycle count of the next tick */
 {
-	size_t time_since_record_in_cycle = core_cycle - m_last_recorded_core_cycle
-			 + (RTOSImpl::CoreCyclePerTick / 2); // This term is added so that the recorded tick is updated to the closest tick rather than the last tick that passed
+	m_last_update_core_cycle += core_cycle_count - m_last_update_core_cycle_count;
+	m_last_update_core_cycle_count = core_cycle_count;
+
+	size_t time_since_record_in_cycle = (size_t) (m_last_update_core_cycle - m_last_recorded_core_cycle)
+			 + RTOSImpl::TickTolerance; // A SysTick interrupt may come slightly before the tick it was programmed for
 	auto result = TXLib::divide(time_since_record_in_cycle, RTOSImpl::CoreCyclePerTick);
 	size_t time_since_record_in_tick = result.first;
+#if defined(RTOS_PORT_POSIX)
+	if (time_since_record_in_tick > m_max_allowable_tick_until_next_update)
+	{
+		// The host delivered the timer signal late; advance by the allowed amount so that no expiration is skipped, the next updates catch up
+		time_since_record_in_tick = m_max_allowable_tick_until_next_update;
+		result.second = time_since_record_in_cycle - time_since_record_in_tick * RTOSImpl::CoreCyclePerTick;
+	}
+#else
 	tx_api_assert(time_since_record_in_tick <= m_max_allowable_tick_until_next_update); // Failing means that a systick update could not execute in time
+#endif
 	m_last_recorded_tick += time_since_record_in_tick;
 	m_last_recorded_core_cycle += time_since_record_in_cycle - result.second;
+	publish();
+	return get_next_tick_core_cycle();
+}
+
+TimeType SystemTimer::get_next_tick_core_cycle(void) const
+{
 	return m_last_recorded_core_cycle + RTOSImpl::CoreCyclePerTick;
 }
 
+TimeType SystemTimer::get_core_cycle_now(void) const
+{
+	return m_last_update_core_cycle + (CoreClock::get_cycle_count() - m_last_update_core_cycle_count);
+}
+
+void SystemTimer::skip_time(size_t core_cycle)
+{
+	size_t core_cycle_count = CoreClock::get_cycle_count();
+	m_last_update_core_cycle += (core_cycle_count - m_last_update_core_cycle_count) + core_cycle;
+	m_last_update_core_cycle_count = core_cycle_count;
+}
+
+void SystemTimer::publish(void)
+// Fill the snapshot not being read before switching the readers to it
+{
+	Snapshot & snapshot = m_snapshots[(m_generation + 1u) & 1u];
+	snapshot.m_tick = m_last_recorded_tick;
+	snapshot.m_tick_core_cycle = m_last_recorded_core_cycle;
+	snapshot.m_update_core_cycle = m_last_update_core_cycle;
+	snapshot.m_update_core_cycle_count = m_last_update_core_cycle_count;
+	__DMB();
+	m_generation = m_generation + 1u;
+}
+
+SystemTimer::Snapshot SystemTimer::read_snapshot(size_t & core_cycle_count) const
+/* Wait-free: at most one more copy, if update_time published a snapshot during the first one
+ * Only a reader that update_time preempted can see that, so the second copy masks the kernel interrupts for its few loads instead of retrying.
+ * A reader that preempts update_time, e.g. an interrupt above the kernel priority, copies the published snapshot and never masks. */
+{
+	size_t generation = m_generation;
+	__DMB();
+	Snapshot snapshot = m_snapshots[generation & 1u];
+	core_cycle_count = CoreClock::get_cycle_count();
+	__DMB();
+
+	if (generation != m_generation)
+	{
+		size_t state = CoreInterrupt::mask_kernel_interrupts();
+		snapshot = m_snapshots[m_generation & 1u];
+		core_cycle_count = CoreClock::get_cycle_count();
+		CoreInterrupt::unmask_kernel_interrupts(state);
+	}
+
+	return snapshot;
+}
+
+TimeType SystemTimer::read_tick(void) const
+{
+	size_t core_cycle_count;
+	return read_snapshot(core_cycle_count).m_tick;
+}
+
+void SystemTimer::read_time(TimeType & tick, TimeType & core_cycle) const
+{
+	size_t core_cycle_count;
+	Snapshot snapshot = read_snapshot(core_cycle_count);
+
+	core_cycle = snapshot.m_update_core_cycle + (core_cycle_count - snapshot.m_update_core_cycle_count);
+	tick = snapshot.m_tick;
+	if (core_cycle > snapshot.m_tick_core_cycle)
+	{
+		tick += (size_t) (core_cycle - snapshot.m_tick_core_cycle) / RTOSImpl::CoreCyclePerTick; // The ticks elapsed while a SysTick interrupt is pending or during a tickless sleep
+	}
+}
+
 
 
 
@@ -46,17 +133,38 @@ static SystemTimer & g_system_timer = g_rtos.m_system_timer;
 
 
 extern "C" void SysTick_Handler(void)
+/* Interrupt of the tick timer (see TickTimer), whichever timer raises it
+ * Fires on every tick, and in between at the deadlines of the threads waiting in core cycles (see Scheduler::set_timer_interrupt)
+ * An interrupt between two ticks leaves the tick unchanged. */
 {
+	TickTimer::acknowledge_interrupt();
+
 	TimeType next_systick_time = g_system_timer.update_time(CoreClock::get_cycle_count());
-	CoreInterrupt::reset_counter(next_systick_time - TimeType(CoreClock::get_cycle_count()));
+	g_rtos.m_scheduler.set_timer_interrupt(next_systick_time);
 	g_system_timer.set_max_allowable_tick(1);
 
 	g_rtos.m_scheduler.systick_update(g_system_timer.get_tick());
 }
 
+#if defined(RTOS_TICK_TIMER_TIM2)
+extern "C" void TIM2_IRQHandler(void)
+{
+	SysTick_Handler(); // SysTick itself stays disabled
+}
+#endif
+
 TimeType system_time(void)
 {
-	return g_system_timer.get_tick();
+	TimeType tick, core_cycle;
+	g_system_timer.read_time(tick, core_cycle);
+	return tick;
+}
+
+TimeType system_time_in_cycles(void)
+{
+	TimeType tick, core_cycle;
+	g_system_timer.read_time(tick, core_cycle);
+	return core_cycle;
 }
 
 } // namespace RTOS
@@ -13,12 +13,29 @@ namespace RTOS
 {
 
 class SystemTimer
+/* 64-bit ticks and core cycles, extended from the 32-bit cycle counter on every update (at least every countdown of the tick timer, well within its wrap period)
+ * The members are written by update_time with the kernel interrupts masked. They are read either with the kernel interrupts masked,
+ *  or wait-free through the snapshots, which update_time publishes for the threads and the interrupts above the kernel priority (see read_snapshot).
+ */
 {
+public:
+	struct Snapshot
+	{
+		TimeType			m_tick;
+		TimeType			m_tick_core_cycle;
+		TimeType			m_update_core_cycle;
+		size_t				m_update_core_cycle_count;
+	};
+
 
 public:
 	TimeType				m_last_recorded_tick;
-	TimeType				m_last_recorded_core_cycle;
+	TimeType				m_last_recorded_core_cycle; // Core cycle at which m_last_recorded_tick started; may exceed m_last_update_core_cycle by RTOSImpl::TickTolerance
+	TimeType				m_last_update_core_cycle; // Core cycle of the last update_time (or skip_time)
+	size_t					m_last_update_core_cycle_count; // Value of the cycle counter then; it lags m_last_update_core_cycle by the time it was stopped
 	size_t					m_max_allowable_tick_until_next_update;
+	Snapshot				m_snapshots[2]; // m_snapshots[m_generation & 1] is the published one
+	size_t volatile	m_generation;
 
 
 public:
@@ -32,16 +49,31 @@ public:
 
 	void initialize(void);
 
-	TimeType update_time(TimeType core_cycle); /* Return the expected core cycle count at the next tick */
+	TimeType update_time(size_t core_cycle_count); /* Return the expected core cycle count at the next tick
+	@core_cycle_count is a value of CoreClock::get_cycle_count, which is extended to 64 bits */
 
 	TimeType get_tick(void) const {return m_last_recorded_tick;}
-	TimeType get_core_cycle(void) const {return m_last_recorded_core_cycle;}
+	TimeType get_core_cycle(void) const {return m_last_recorded_core_cycle;} // Core cycle count at which the current tick started
+	TimeType get_next_tick_core_cycle(void) const; // As returned by the last update_time
+	TimeType get_core_cycle_now(void) const; // The kernel interrupts must be masked
+	void skip_time(size_t core_cycle); // Account for @core_cycle during which the cycle counter was stopped (see SleepStates::enter); update_time must follow
 	void set_max_allowable_tick(size_t tick) {m_max_allowable_tick_until_next_update = tick;}
 
+	TimeType read_tick(void) const; // As get_tick, without masking
+	void read_time(TimeType & tick, TimeType & core_cycle) const; // Current tick (counting the ticks not yet recorded) and core cycle, without masking
+
+
+private:
+	void publish(void);
+	Snapshot read_snapshot(size_t & core_cycle_count) const;
+
 
 
 };
 
 extern "C" void SysTick_Handler(void); // Interrupt handler
+#if defined(RTOS_TICK_TIMER_TIM2)
+extern "C" void TIM2_IRQHandler(void); // Interrupt handler, in place of SysTick_Handler
+#endif
 
 } // namespace RTOS
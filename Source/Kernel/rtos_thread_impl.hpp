@@ -7,7 +7,7 @@
 
 #pragma once
 
-#include "./Source/PublicApi/rtos_thread.hpp"
+#include "./Source/PublicApi/rtos.hpp"
 
 namespace RTOS
 {
@@ -18,6 +18,8 @@ class ThreadImpl : public Thread
 {
 friend class Mutex;
 friend class MessageQueue;
+friend class MemoryPool;
+friend class Arena;
 friend class PriorityList;
 friend class Scheduler;
 friend class ThreadMgr;
@@ -25,22 +27,35 @@ friend class CoreInfo;
 friend class ExpirationList;
 friend class SleepHeap;
 friend class ExpireHeap;
+friend class Trace;
+friend class RTOSImpl;
 friend void PendSV_Handler(void);
+friend size_t get_cpu_usage_report(CpuUsage * report, size_t capacity);
+friend void get_system_load(SystemLoad & load);
+friend void set_heap_tag(size_t tag);
 
 
 
 private:
 	static constexpr size_t const StackLimitIdentifier = 0xDEADBEEF;
-	static constexpr bool const PrefillStack = false;
 
 public:
 	struct StackContext;
 
+#if defined(RTOS_PORT_POSIX)
+	static constexpr bool const UseMpuStackGuard = false; // No MPU in a user-space process
+#else
+	static constexpr bool const UseMpuStackGuard = true; /* Place a no-access MPU region at the bottom of the running thread's stack
+	An overflow then faults immediately, and the stack limit identifier is no longer checked */
+#endif
+	static bool s_paint_stack; // Runtime option; see RTOS::set_stack_painting
+
 
 public:
 
 
 	void populate_stack_context(void);
+	size_t get_usable_stack_begin(void) const; // Lowest stack address the thread can write to
 
 	static ThreadImpl & get_thread_from_m_priority_link(TXLib::LinkedCycleUnsafe & link)
 	{
@@ -52,7 +67,13 @@ public:
 		return *reinterpret_cast<ThreadImpl *>(reinterpret_cast<size_t>(&link) - __builtin_offsetof(ThreadImpl, m_expire_link));
 	}
 
+	static ThreadImpl & get_thread_from_m_thread_link(TXLib::LinkedCycleUnsafe & link)
+	{
+		return *reinterpret_cast<ThreadImpl *>(reinterpret_cast<size_t>(&link) - __builtin_offsetof(ThreadImpl, m_thread_link));
+	}
+
 	void initialize_self(FunctionPtr entry, size_t entry_argument, size_t priority, size_t stack_size);
+	void initialize_self(FunctionPtr entry, size_t entry_argument, size_t priority, void * stack_ptr, size_t stack_size);
 
 
 public:
@@ -0,0 +1,47 @@
+/*
+ * rtos_trace.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+
+#include "rtos_trace.hpp"
+#include "./Source/PublicApi/rtos.hpp"
+
+
+
+
+namespace RTOS
+{
+
+
+#ifdef RTOS_TRACE_ENABLE
+
+Trace::Buffer Trace::s_buffer;
+
+void set_tracing(bool enable)
+{
+	Trace::s_buffer.enabled = enable ? 1u : 0u;
+}
+
+void const * get_trace_buffer(size_t & size)
+{
+	size = sizeof(Trace::s_buffer);
+	return &Trace::s_buffer;
+}
+
+#else
+
+void set_tracing(bool enable) {}
+
+void const * get_trace_buffer(size_t & size)
+{
+	size = 0;
+	return nullptr;
+}
+
+#endif
+
+
+} // namespace RTOS
@@ -0,0 +1,141 @@
+/*
+ * rtos_trace.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "./Source/Driver/rtos_port.hpp"
+#include "rtos_config.hpp"
+#include "rtos_thread_impl.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef RTOS_TRACE_ENABLE
+
+	#define RTOS_TRACE_INIT(frequency)										Trace::initialize(frequency)
+	#define RTOS_TRACE_THREAD(type, thread, object, peer)	Trace::record_thread(Trace::Type::type, thread, object, peer)
+	#define RTOS_TRACE_TICK(time)													Trace::record_tick(time)
+
+#else
+
+	#define RTOS_TRACE_INIT(frequency)
+	#define RTOS_TRACE_THREAD(type, thread, object, peer)
+	#define RTOS_TRACE_TICK(time)
+
+#endif
+
+
+
+namespace RTOS
+{
+
+
+class Trace
+/* Ring buffer of scheduler events, decoded on the host by Tools/rtos_trace.py
+ * The buffer is written with interrupts masked (kernel lock, SysTick or PendSV), so recording an event is a few stores.
+ * Objects (threads, mutexes, queues) are identified by the low 32 bits of their address.
+ */
+{
+public:
+	static constexpr uint32_t const Magic = 0x52545452; // "RTTR" in a little-endian dump
+	static constexpr uint16_t const Version = 3; // 2: Thread::State gained the pool states; 3: the notification states
+	static constexpr size_t const CapacityLog2 = 8;
+	static constexpr size_t const Capacity = 1u << CapacityLog2;
+
+	enum class Type : uint8_t
+	{
+		Register,				// Thread initialized; object is the entry function
+		State,					// Thread changed state; object is the mutex, queue, pool or expire time involved, peer the mutex owner or the waking thread
+		Priority,				// Effective priority changed by inheritance; peer is the thread the priority is inherited from
+		ContextSwitch,	// PendSV switched to thread; object is the outgoing thread
+		Tick,						// SysTick handler; object is the system time
+	};
+
+	struct Event
+	{
+		uint32_t							cycle;		// Low 32 bits of the core cycle counter
+		uint32_t							thread;
+		uint32_t							object;
+		uint32_t							peer;
+		uint8_t								type;
+		uint8_t								state;		// Thread::State after the event
+		uint16_t							priority;	// Effective priority after the event
+	};
+	static_assert(sizeof(Event) == 20, "The decoder assumes the packed layout");
+
+	struct Buffer // Dumped as is; see Tools/rtos_trace.py
+	{
+		uint32_t							magic;
+		uint16_t							version;
+		uint16_t							event_size;
+		uint32_t							capacity;
+		uint32_t							cycle_frequency;
+		uint32_t volatile			head;			// Number of events recorded; the last Capacity of them are kept
+		uint32_t volatile			enabled;
+		Event									events[Capacity];
+	};
+
+
+public:
+	static Buffer							s_buffer;
+
+
+public:
+
+	static uint32_t get_id(void const * object)
+	{
+		return static_cast<uint32_t>(reinterpret_cast<size_t>(object));
+	}
+
+	static void initialize(size_t cycle_frequency)
+	{
+		s_buffer.magic = Magic;
+		s_buffer.version = Version;
+		s_buffer.event_size = sizeof(Event);
+		s_buffer.capacity = Capacity;
+		s_buffer.cycle_frequency = cycle_frequency;
+		s_buffer.head = 0;
+		s_buffer.enabled = 1;
+	}
+
+	static void record(Type type, uint32_t thread, uint8_t state, uint16_t priority, uint32_t object, uint32_t peer)
+	// The kernel interrupts must be masked
+	{
+		if (!s_buffer.enabled) {return;}
+
+		uint32_t head = s_buffer.head;
+		Event & event = s_buffer.events[head & (Capacity - 1u)];
+		event.cycle = CoreClock::get_cycle_count();
+		event.thread = thread;
+		event.object = object;
+		event.peer = peer;
+		event.type = static_cast<uint8_t>(type);
+		event.state = state;
+		event.priority = priority;
+		s_buffer.head = head + 1u;
+	}
+
+	static void record_thread(Type type, ThreadImpl const & thread, uint32_t object, void const * peer)
+	{
+		record(type, get_id(&thread), static_cast<uint8_t>(thread.m_state), thread.m_effective_priority, object, get_id(peer));
+	}
+
+	static void record_thread(Type type, ThreadImpl const & thread, void const * object, void const * peer)
+	{
+		record_thread(type, thread, get_id(object), peer);
+	}
+
+	static void record_tick(TimeType time)
+	{
+		record(Type::Tick, 0, 0, 0, static_cast<uint32_t>(time.m_time), 0);
+	}
+
+};
+
+
+
+} // namespace RTOS
@@ -12,6 +12,8 @@
 #include "rtos_thread.hpp"
 #include "rtos_mutex.hpp"
 #include "rtos_message_queue.hpp"
+#include "rtos_memory_pool.hpp"
+#include "rtos_arena.hpp"
 
 
 namespace RTOS
@@ -27,11 +29,161 @@ Hardware and thread initialization can be placed in @entry. */
 
 // Memory operations
 
-void * alloc(size_t size); // Allocate a memory block
-void free(void * mem_ptr); // Free the memory block
-size_t used_memory(void); // Get total memory used by OS memory allocator
+void * alloc(size_t size); /* Allocate a memory block; safe to call from any thread
+Blocks of up to 256 bytes are served from a small cache of the calling thread without taking the kernel lock. */
+void free(void * mem_ptr); // Free the memory block; a small block goes to the cache of the calling thread, whichever thread allocated it
+size_t used_memory(void); // Get total memory used by OS memory allocator, including the blocks cached by threads
 size_t unused_memory(void); // Get total memory remaining
 
+struct MemoryStatistics
+{
+	size_t												used_size;				// As used_memory()
+	size_t												unused_size;			// As unused_memory()
+	size_t												largest_free_size;	// Largest size one alloc can take: the largest free block with TLSF, possibly less with half-fit, which only serves sizes it can fit by class
+	size_t												fragmentation_permille; // 1000 * (1 - largest_free_size / unused_size); 0 when all the free memory can be taken by one alloc
+};
+
+void get_memory_statistics(MemoryStatistics & statistics); // The kernel lock is held for each step of the measure only, so the figures may come from slightly different instants
+
+
+// Heap profiling operations
+
+constexpr size_t const HeapOwnerCount = 16;
+constexpr size_t const HeapHistogramSize = 16;
+
+struct HeapOwner // Live blocks of RTOS::alloc carrying one tag
+{
+	size_t												tag;
+	size_t												live_count;
+	size_t												live_size;		// Requested bytes, excluding headers and rounding
+	size_t												peak_size;		// Highest live_size
+	size_t												alloc_count;	// Allocations since initialization; 0 marks an unused entry
+};
+
+struct HeapStatistics
+{
+	size_t												live_count;
+	size_t												live_size;		// As HeapOwner::live_size, for all tags
+	size_t												peak_size;		// Highest live_size
+	size_t												peak_used_size; // Highest used_memory(), i.e. the high-water mark of the heap arena
+	size_t												alloc_count;
+	size_t												failed_count;	// Allocations which returned nullptr
+	size_t												serial;				// Serial number of the next block allocated (see get_heap_blocks)
+	size_t												histogram[HeapHistogramSize]; // histogram[i] counts the allocations of [2^i, 2^(i+1)) bytes; the first and last buckets are open-ended
+	size_t												untracked_count; // Allocations whose tag did not fit in @owners
+	HeapOwner											owners[HeapOwnerCount]; // Unordered
+};
+
+struct HeapBlock
+{
+	void const *									mem_ptr;	// As returned by RTOS::alloc
+	size_t												size;			// Requested size
+	size_t												tag;
+	size_t												serial;
+};
+
+void set_heap_tag(size_t tag); /* Tag the blocks the running thread allocates from now on
+A thread's blocks are tagged with the address of its Thread by default; blocks allocated in handler mode or by the idle thread are tagged 0. */
+void get_heap_statistics(HeapStatistics & statistics); /* Copy the heap profile; all figures are 0 if the kernel is built without the heap profiler
+Like get_critical_section_statistics, interrupts are only masked for the copy of one owner at a time. */
+void reset_heap_peaks(void); // Lower every peak to the current figure, e.g. to measure the peaks of one phase of the application
+size_t get_heap_blocks(HeapBlock * report, size_t capacity, size_t min_serial); /* Write up to @capacity live blocks whose serial is at least @min_serial to @report, newest first
+Return the number of blocks written. Blocks still live long after the serial was read from HeapStatistics::serial are leak candidates.
+Interrupts are masked during the walk, which visits at most @capacity + 1 blocks. */
+
+
+// Load operations
+
+constexpr size_t const LoadAverageCount = 3;
+
+struct SystemLoad
+{
+	uint64_t											elapsed_cycles;	// Core cycles since initialization
+	uint64_t											idle_cycles;		// Core cycles spent in the idle thread
+	size_t												idle_permille;	// Idle share over the last load sample period (100 ms)
+	size_t												load_permille[LoadAverageCount]; // Busy share averaged exponentially over about 1 s, 10 s and 60 s
+};
+
+void get_system_load(SystemLoad & load); // Take a consistent snapshot of the load figures, which the kernel updates on ticks
+
+
+// Power operations
+
+constexpr size_t const WakeLatencyConstraintCount = 8;
+
+struct IdleStateStatistics // One sleep state of the idle thread, in core cycles
+{
+	char const *									name;
+	size_t												exit_latency_cycles;			// As assumed by the idle governor
+	size_t												target_residency_cycles;	// Shortest idle period for which the state is chosen
+	size_t												entry_count;
+	size_t												premature_count;	// Wake-ups well before the planned time, by an interrupt other than the timer
+	uint64_t											residency_cycles;	// Time spent in the state, including the time the cycle counter was stopped
+	size_t												max_wake_latency_cycles; // Longest delay from the planned wake-up to the resumption of the idle thread, as seen by the cycle counter
+	uint64_t											total_wake_latency_cycles; // Over the entries that were not premature
+};
+
+size_t add_wake_latency_constraint(size_t max_latency_us); /* Keep the core out of the sleep states whose exit latency exceeds @max_latency_us, until the constraint is removed
+The tightest active constraint applies. Return a handle for remove_wake_latency_constraint, or 0 if WakeLatencyConstraintCount constraints are already active. */
+void remove_wake_latency_constraint(size_t handle);
+size_t get_idle_statistics(IdleStateStatistics * report, size_t capacity); // Write the statistics of up to @capacity sleep states to @report, shallowest first; return the number of states
+void reset_idle_statistics(void);
+
+
+// Profiling operations
+
+constexpr size_t const ProfileHistogramSize = 20;
+
+struct ProfileStatistics // Durations of one kernel section, in core cycles, excluding the sections nested in it
+{
+	char const *									name;
+	size_t												count;
+	size_t												min_cycles;
+	size_t												max_cycles;
+	uint64_t											total_cycles;
+	size_t												histogram[ProfileHistogramSize]; // histogram[i] counts the durations in [2^i, 2^(i+1)); the first and last buckets are open-ended
+};
+
+size_t get_profile_report(ProfileStatistics * report, size_t capacity); /* Write the statistics of up to @capacity kernel sections to @report
+Return the total number of kernel sections, or 0 if the kernel is built without the profiler. */
+void reset_profile_statistics(void); // Clear the statistics of every kernel section
+
+
+// Critical section operations
+
+constexpr size_t const CriticalSectionSiteCount = 16;
+
+struct CriticalSectionSite
+{
+	void const *									site;	// Code address where the critical section was entered (resolve with addr2line)
+	size_t												count;
+	size_t												max_cycles;
+	uint64_t											total_cycles;
+};
+
+struct CriticalSectionStatistics // Intervals during which the kernel masks interrupts, in core cycles
+{
+	size_t												count;
+	size_t												max_cycles;
+	void const *									max_site;	// Site of the longest critical section, i.e. the worst offender
+	uint64_t											total_cycles;
+	size_t												histogram[ProfileHistogramSize]; // Same buckets as ProfileStatistics::histogram
+	size_t												untracked_count; // Sections whose site did not fit in @sites
+	CriticalSectionSite						sites[CriticalSectionSiteCount]; // Unordered; unused entries have a null site
+};
+
+void get_critical_section_statistics(CriticalSectionStatistics & statistics); /* Copy the statistics of the kernel critical sections
+Each site is copied consistently, and interrupts are only masked for the copy of one site at a time. */
+void reset_critical_section_statistics(void);
+
+
+// Tracing operations
+
+void set_tracing(bool enable); /* Start or stop recording scheduler events (tracing is on after initialization)
+Stopping right after detecting a latency spike keeps the events leading to it in the buffer. */
+void const * get_trace_buffer(size_t & size); /* Return the trace ring buffer and write its size in bytes to @size; return nullptr if the kernel is built without tracing
+Stop tracing before copying the buffer out; Tools/rtos_trace.py converts a copy into Chrome/Perfetto JSON. */
+
 
 
 
@@ -0,0 +1,93 @@
+/*
+ * rtos_arena.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "rtos_thread.hpp"
+#include "./External/MyLib/tx_assert.h"
+#include <stddef.h>
+
+namespace RTOS
+{
+
+class Scheduler;
+
+class Arena
+// Implemented in Source/Kernel/rtos_scheduler.cpp
+/* Bump-pointer allocation from chunks obtained with RTOS::alloc, for scratch buffers which are released all together
+ * Nothing is freed block by block: reset or release to a mark rewinds the arena in O(1), and keeps the chunks for the next allocations.
+ * The chunks only return to the heap on trim or uninitialize, or when the thread the arena is bound to terminates.
+ * An arena is not locked; it must be used by one thread at a time (the thread it is bound to, if any). */
+{
+	friend Scheduler;
+	friend Thread;
+
+
+public:
+	static constexpr size_t const Alignment = 8;
+
+	struct Mark // Position of the arena, see get_mark
+	{
+		void *												chunk;
+		char *												top;
+		size_t												used_size;
+	};
+
+
+private:
+	struct Chunk // Header of a chunk, followed by its payload
+	{
+		Chunk *												m_next;	// Chunks in allocation order; the ones after m_chunk are spare
+		size_t												m_size; // Payload size
+	};
+
+	Chunk *													m_first_chunk;
+	Chunk *													m_chunk;		// Chunk being filled
+	char *													m_top;
+	char *													m_end;
+	size_t													m_chunk_size;
+	size_t													m_used_size;	// Bytes allocated in the chunks before m_chunk, for get_used_size
+	Thread *												m_thread;		// Thread the arena is bound to, or nullptr
+	Arena *													m_next_bound; // Next arena bound to the same thread
+
+
+
+public:
+	Arena(void) noexcept : m_first_chunk(nullptr), m_chunk(nullptr), m_top(nullptr), m_end(nullptr), m_chunk_size(0), m_used_size(0), m_thread(nullptr), m_next_bound(nullptr) {}
+	Arena(Arena const &) noexcept = delete;
+	Arena(Arena &&) noexcept = delete;
+	~Arena(void) noexcept {uninitialize();}
+	void operator=(Arena const &) noexcept = delete;
+	void operator=(Arena &&) noexcept = delete;
+
+	inline bool is_initialized(void) const {return m_chunk_size != 0;}
+	inline size_t get_chunk_size(void) const {return m_chunk_size;}
+
+	void initialize(size_t chunk_size); // Chunks are allocated on demand; a request larger than @chunk_size gets a chunk of its own
+	void uninitialize(void); // Return every chunk to the heap and unbind the arena
+
+	void bind(void); /* Bind the arena to the running thread, which uninitializes it when it terminates or is uninitialized after being killed
+	This reclaims the chunks of a thread that does not reach its own cleanup code. */
+	void unbind(void);
+
+	void * alloc(size_t size); // Return nullptr if a new chunk is needed and RTOS::alloc fails
+	Mark get_mark(void) const {return Mark{m_chunk, m_top, m_used_size};}
+	void release(Mark const & mark); // Release every block allocated since @mark was taken
+	void reset(void); // Release every block
+	void trim(void); // Return the spare chunks to the heap
+	size_t get_used_size(void) const; // Bytes allocated since the last reset, including the alignment padding and the unused tails of full chunks
+
+
+private:
+	bool move_to_next_chunk(size_t size);
+	static void release_bound_arenas(Thread & thread);
+
+};
+
+
+
+} // namespace RTOS
@@ -0,0 +1,93 @@
+/*
+ * rtos_memory_pool.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: tian_
+ */
+
+#pragma once
+
+#include "rtos_thread.hpp"
+#include "./Source/Kernel/rtos_priority_list.hpp"
+#include "./External/MyLib/tx_assert.h"
+#include <stddef.h>
+
+namespace RTOS
+{
+
+class Scheduler;
+
+class MemoryPool
+// Implemented in Source/Kernel/rtos_scheduler.cpp
+/* Blocks of a fixed size, allocated and freed in O(1) from a list of free blocks
+ * The blocks live in a buffer given to initialize (e.g. a static array) or allocated once from the kernel heap,
+ *  so the pool does not fragment and does not contend with RTOS::alloc. */
+{
+	friend Scheduler;
+
+
+public:
+	static constexpr size_t const BlockAlignment = 8; // Blocks can hold stacks and 64-bit members
+
+	static constexpr size_t get_rounded_block_size(size_t block_size)
+	{
+		return ((block_size > sizeof(void *) ? block_size : sizeof(void *)) + BlockAlignment - 1u) & ~(BlockAlignment - 1u); // A free block holds a pointer
+	}
+
+	static constexpr size_t get_buffer_size(size_t block_size, size_t block_count) // Size of a buffer holding @block_count blocks
+	{
+		return get_rounded_block_size(block_size) * block_count;
+	}
+
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock *										m_next;
+	};
+
+	FreeBlock *											m_free_blocks;
+	char *													m_buffer;
+	size_t													m_block_size;
+	size_t													m_block_count;
+	size_t													m_free_count;
+	size_t													m_min_free_count; // Lowest m_free_count since initialization
+	bool														m_owns_buffer;
+	PriorityList										m_blocked_threads;
+
+
+
+public:
+	MemoryPool(void) noexcept : m_free_blocks(nullptr), m_buffer(nullptr), m_block_size(0), m_block_count(0), m_free_count(0), m_min_free_count(0), m_owns_buffer(false) {}
+	MemoryPool(MemoryPool const &) noexcept = delete;
+	MemoryPool(MemoryPool &&) noexcept = delete;
+	~MemoryPool(void) noexcept {TX_ASSERT(m_blocked_threads.get_highest_priority() == PriorityList::INVALID_PRIORITY);};
+	void operator=(MemoryPool const &) noexcept = delete;
+	void operator=(MemoryPool &&) noexcept = delete;
+
+	inline bool is_initialized(void) const {return m_buffer != nullptr;}
+	inline size_t get_block_size(void) const {return m_block_size;}
+	inline size_t get_block_count(void) const {return m_block_count;}
+	inline size_t get_free_count(void) const {return m_free_count;}
+	inline size_t get_min_free_count(void) const {return m_min_free_count;}
+
+	bool initialize(size_t block_size, size_t block_count); // Allocate the blocks from the kernel heap; return false if the heap is exhausted
+	void initialize(void * buffer, size_t buffer_size, size_t block_size); // Carve the blocks out of @buffer, which must be aligned to BlockAlignment
+	void uninitialize(void); // Every block must have been freed
+
+	void * alloc(void); // Allocate a block (if none is free, wait until one is)
+	void * try_alloc(size_t max_wait_time); // Wait time in ticks (0 does not wait); return nullptr on timeout
+	void * try_alloc_until_cycles(TimeType core_cycle); // Give up when system_time_in_cycles() reaches @core_cycle, with the resolution of sleep_until_cycles
+	void free(void * block); // Return a block to the pool and relinquish to a higher-priority thread waiting for it
+
+
+private:
+	void * try_alloc_until(TimeType expire_time, bool in_cycles);
+	void * pop_block(void);
+	bool contains(void const * block) const;
+
+};
+
+
+
+} // namespace RTOS
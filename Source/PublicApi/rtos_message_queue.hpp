@@ -45,11 +45,15 @@ public:
 
 	void initialize(size_t capacity);
 	std::pair<size_t, bool> try_pull(size_t max_wait_time); // Wait time in ticks
+	std::pair<size_t, bool> try_pull_until_cycles(TimeType core_cycle); // Give up when system_time_in_cycles() reaches @core_cycle, with the resolution of sleep_until_cycles
 	size_t pull(void); // Pull next message (if none is available, wait until one is)
 	bool push(size_t message); /* Post message on the queue and relinquish to a higher-priority ready thread if one is available
 	Return false if the message is not posted (due to a full queue) */
 
 
+private:
+	std::pair<size_t, bool> try_pull_until(TimeType expire_time, bool in_cycles);
+
 };
 
 
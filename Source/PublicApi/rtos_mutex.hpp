@@ -40,6 +40,7 @@ public:
 	void operator=(Mutex &&) = delete;
 
 	bool try_lock(size_t max_wait_time); // Wait time is measured in ticks
+	bool try_lock_until_cycles(TimeType core_cycle); // Give up when system_time_in_cycles() reaches @core_cycle, with the resolution of sleep_until_cycles
 	void lock(void);
 	void unlock(void); // Automatically relinquish to higher-priority thread after unlock
 	bool is_locked(void) const {return m_owner != nullptr;}
@@ -50,6 +51,8 @@ public:
 private:
 	size_t get_inherited_priority(void) const {return m_blocked_threads.get_highest_priority();}
 
+	bool try_lock_until(TimeType expire_time, bool in_cycles);
+
 	void set_owner(ThreadImpl & thread);
 	void set_orphan(void);
 
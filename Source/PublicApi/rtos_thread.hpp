@@ -8,6 +8,8 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+#include <utility>
 #include "rtos_time.hpp"
 #include "./External/MyLib/tx_linkedlist.hpp"
 #include "./External/MyLib/tx_assert.h"
@@ -20,6 +22,15 @@ typedef size_t (*FunctionPtr)(size_t arg);
 
 class Mutex;
 class PriorityList;
+class Arena;
+
+struct AllocCache // Free blocks of the small size classes of RTOS::alloc kept for one thread (see RTOSImpl::alloc)
+{
+	static constexpr size_t const ClassCount = 5; // 16, 32, 64, 128 and 256 bytes
+
+	void *												m_blocks[ClassCount]; // Singly linked through their first word
+	uint8_t												m_counts[ClassCount];
+};
 
 class Thread
 // Implemented in Source/Kernel/rtos_scheduler.cpp
@@ -28,7 +39,6 @@ class Thread
 
 protected:
 	static constexpr size_t const StackLimitIdentifier = 0xDEADBEEF;
-	static constexpr bool const PrefillStack = false;
 
 protected:
 
@@ -44,6 +54,10 @@ protected:
 		SoftBlockedByMutex,
 		BlockedByMessage,
 		SoftBlockedByMessage,
+		BlockedByPool,
+		SoftBlockedByPool,
+		BlockedByNotification,
+		SoftBlockedByNotification,
 		Terminated,
 	};
 
@@ -52,6 +66,10 @@ protected:
 	void * 												m_sp;
 	size_t												m_stack_begin;
 	size_t												m_stack_end;
+	bool													m_owns_stack;	// Whether the stack was allocated by the RTOS (rather than provided by the caller)
+	bool													m_stack_painted; // Whether the unused stack was filled with StackLimitIdentifier on initialization
+	size_t												m_stack_used_begin; // Lowest stack address known to have been written (only tracked for painted stacks)
+	TXLib::LinkedCycleUnsafe			m_thread_link;			// Link to the list of all initialized threads
 	FunctionPtr 									m_entry;
 	size_t												m_entry_argument;
 	size_t												m_base_priority;	// Actual priority could be higher due to inheritance from owning mutexes
@@ -60,10 +78,19 @@ protected:
 	TXLib::LinkedCycleUnsafe			m_priority_link;		// Link to the priority list
 	TXLib::LinkedCycleUnsafe			m_expire_link;
 	TimeType											m_expire_time;
-	size_t												m_cpu_cycle_used;
+	bool													m_expire_in_cycles;	// m_expire_time of a soft-blocked thread is in core cycles, in the precise expiration list
+	uint64_t											m_cpu_cycle_used;		// Core cycles executed, updated on context switches and ticks
+	uint64_t											m_cpu_cycle_reported; // Value of m_cpu_cycle_used at the last get_cpu_usage_report
 	State													m_state;
 	Mutex *												m_blocking_mutex;
+	size_t												m_handed_off_message;	// Written by MessageQueue::push while the thread is blocked on the queue
+	bool													m_message_handed_off;
+	uint32_t											m_notification;			// Notification word (see notify_bits)
+	bool													m_notification_pending; // Set by the notify operations, cleared when the thread takes the word
 	TXLib::LinkedCycle						m_owned_mutex;
+	AllocCache										m_alloc_cache;
+	size_t												m_heap_tag;					// Tag of the blocks the thread allocates (see set_heap_tag)
+	Arena *												m_bound_arenas;			// Arenas uninitialized when the thread terminates (see Arena::bind)
 
 
 public:
@@ -77,12 +104,52 @@ public:
 	bool is_initialized(void) const {return m_state != State::Reset;}
 	void initialize(FunctionPtr entry, size_t entry_argument, size_t priority, size_t stack_size);
 	void initialize(FunctionPtr entry, size_t priority, size_t stack_size) {initialize(entry, 0, priority, stack_size);}
+	void initialize(FunctionPtr entry, size_t entry_argument, size_t priority, void * stack_ptr, size_t stack_size); /* Use the caller-provided memory [stack_ptr, stack_ptr + stack_size) as stack
+	The memory must be aligned to double-word and remain valid until the thread is uninitialized. */
 	void uninitialize(void);
 
 	void pause(void);
 	void unpause(void);
 	void kill(void);
 
+	void notify_bits(uint32_t bits); /* Set @bits in the notification word of the thread, and wake the thread up if it waits for a notification (see wait_notification)
+	The notify operations may be called from threads and from interrupts of kernel priority; they need no kernel object and allocate nothing. */
+	void notify_increment(void); // Increment the notification word, e.g. to count events
+	void notify_overwrite(uint32_t value); // Replace the notification word with @value
+
+	size_t get_stack_size(void) const {return m_stack_end - m_stack_begin;}
+	size_t get_stack_peak_usage(void) const {return m_stack_painted ? m_stack_end - m_stack_used_begin : 0;} /* Return 0 if the stack is not painted
+	The value is updated incrementally by the idle thread, hence may lag behind the actual usage. */
+	size_t get_recommended_stack_size(void) const; // Peak usage with a safety margin; return 0 if the stack is not painted
+	uint64_t get_cpu_cycles(void) const; // Core cycles the thread has executed since initialization, including its current time slice
+
+};
+
+
+struct StackUsage
+{
+	Thread const *								thread;
+	size_t												stack_size;
+	size_t												peak_usage;
+	size_t												recommended_size;
+};
+
+
+template <size_t StackSize>
+class StaticThread : public Thread
+/* Thread which carries its own stack; a statically-allocated instance requires no heap allocation.
+ * The instance can be placed in a dedicated memory section, e.g. __attribute__((section(".ccmram"))). */
+{
+	static_assert((StackSize & 0b111) == 0, "Stack size must be a multiple of double-word");
+
+private:
+	alignas(8) char								m_stack[StackSize];
+
+public:
+	StaticThread(void) noexcept = default;
+
+	void initialize(FunctionPtr entry, size_t entry_argument, size_t priority) {Thread::initialize(entry, entry_argument, priority, m_stack, StackSize);}
+	void initialize(FunctionPtr entry, size_t priority) {initialize(entry, 0, priority);}
 };
 
 
@@ -90,6 +157,32 @@ public:
 
 void relinquish(void); // Only relinquish to higher or equal priority ready threads
 void sleep(size_t sleep_duration);
+void sleep_for_us(size_t sleep_duration_us); /* Sleep with the resolution of the SysTick countdown (8 core cycles) rather than a tick
+The wakeup is not bound to a tick: SysTick is programmed to fire at the deadline, and the ticks are unaffected. */
+void sleep_until_cycles(TimeType core_cycle); // Sleep until system_time_in_cycles() reaches @core_cycle; return at once if it is already reached
+uint32_t wait_notification(uint32_t clear_mask); /* Wait until the thread is notified, then return its notification word and clear the bits of @clear_mask in it
+A notification sent while the thread is not waiting stays pending, so the next call returns at once. */
+std::pair<uint32_t, bool> try_wait_notification(uint32_t clear_mask, size_t max_wait_time); // As wait_notification, waiting for at most @max_wait_time ticks; on timeout, return false and leave the word unchanged
+
+
+// Stack diagnostics
+
+void set_stack_painting(bool enable); /* Paint the stacks of threads initialized afterwards so that their peak usage can be measured
+Painting can be enabled before RTOS::initialize to include the first thread and the idle thread. */
+size_t get_stack_usage_report(StackUsage * report, size_t capacity); /* Write the stack usage of up to @capacity initialized threads to @report
+Return the total number of initialized threads. */
+
+
+struct CpuUsage
+{
+	Thread const *								thread;
+	uint64_t											cpu_cycles;			// See Thread::get_cpu_cycles
+	size_t												usage_permille;	// Share of the core used since the previous report
+};
+
+size_t get_cpu_usage_report(CpuUsage * report, size_t capacity); /* Write the CPU usage of up to @capacity initialized threads (including the idle thread) to @report
+The usage is measured over the interval since the previous call, so a monitoring thread calling it periodically obtains windowed figures.
+Return the total number of initialized threads. */
 
 
 } // namespace RTOS
@@ -8,21 +8,25 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 namespace RTOS
 {
 
 class TimeType
+/* Time in ticks or in core cycles, counted on 64 bits from RTOS::initialize
+ * The count does not wrap in the lifetime of a device (about 36000 years of core cycles at 16 MHz), so any two instances compare correctly.
+ * The comparisons remain modular, which only matters for the values derived from get_max_positive. */
 {
 private:
-	static constexpr size_t const NegativeStart = 0x80000000;
+	static constexpr uint64_t const NegativeStart = (uint64_t) 1 << 63;
 	static_assert(NegativeStart << 1u == 0 && NegativeStart > 0);
 
 public:
-	size_t m_time;
+	uint64_t m_time;
 
 public:
-	static size_t get_max_positive(void)
+	static uint64_t get_max_positive(void)
 	/* Return a number @return with the property that for every instance @time of TimeType
 	 *   (@time + @return > @time) and (@time - @return < @time)
 	 */
@@ -33,16 +37,16 @@ public:
 	TimeType(void) noexcept {};
 	TimeType(TimeType const &) noexcept = default;
 	TimeType(TimeType && b) noexcept = default;
-	constexpr TimeType(size_t b) noexcept : m_time(b) {}
+	constexpr TimeType(uint64_t b) noexcept : m_time(b) {}
 	~TimeType(void) noexcept = default;
 	void operator=(TimeType const & b) {m_time = b.m_time;};
 	void operator=(TimeType && b) {m_time = b.m_time;};
 
-	TimeType operator+(size_t b) const {return TimeType(m_time + b);}
-	TimeType operator-(size_t b) const {return TimeType(m_time - b);}
-	void operator+=(size_t b) {m_time += b;}
-	void operator-=(size_t b) {m_time -= b;}
-	size_t operator-(TimeType const & b) const {return m_time - b.m_time;}
+	TimeType operator+(uint64_t b) const {return TimeType(m_time + b);}
+	TimeType operator-(uint64_t b) const {return TimeType(m_time - b);}
+	void operator+=(uint64_t b) {m_time += b;}
+	void operator-=(uint64_t b) {m_time -= b;}
+	uint64_t operator-(TimeType const & b) const {return m_time - b.m_time;}
 	bool operator>(TimeType const & b) const {return b.m_time - m_time >= NegativeStart;}
 	bool operator>=(TimeType const & b) const {return m_time - b.m_time < NegativeStart;}
 	bool operator<(TimeType const & b) const {return m_time - b.m_time >= NegativeStart;}
@@ -51,7 +55,10 @@ public:
 	bool operator!=(TimeType const & b) const {return m_time != b.m_time;}
 };
 
-TimeType system_time(void);
+TimeType system_time(void); /* In ticks
+Consistent from any context, including the interrupts above the kernel priority (see SystemTimer::read_time).
+Wait-free: a read that an update of the time interleaves with makes one more copy, with the kernel interrupts masked. */
+TimeType system_time_in_cycles(void); // Core cycles, i.e. DWT->CYCCNT extended to 64 bits; same properties as system_time
 
 
 
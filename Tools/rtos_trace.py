@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+#
+# rtos_trace.py
+#
+#  Created on: Oct 19, 2026
+#      Author: tian_
+#
+# Convert a dump of the kernel trace buffer (RTOS::get_trace_buffer, layout in Source/Kernel/rtos_trace.hpp)
+#  into Chrome trace JSON, which can be opened in https://ui.perfetto.dev or chrome://tracing.
+#
+#   python3 Tools/rtos_trace.py trace.bin -o trace.json [--elf main.elf]
+#
+# The buffer can also be dumped by a debugger once tracing is stopped, e.g. in gdb:
+#
+#   dump binary value trace.bin RTOS::Trace::s_buffer
+#
+# Output:
+#   - one track per thread with its scheduler state (Running, Ready, BlockedByMutex, ...),
+#   - a "core" track with the thread on the core after each context switch, and the ticks,
+#   - flow arrows from a thread blocking on a mutex to the owner of the mutex,
+#     and from the thread unlocking a mutex, pushing a message or freeing a pool block to the thread it wakes up.
+
+import argparse
+import json
+import struct
+import subprocess
+import sys
+
+
+HEADER = struct.Struct('<IHHIIII')  # magic, version, event_size, capacity, cycle_frequency, head, enabled
+EVENT = struct.Struct('<IIIIBBH')   # cycle, thread, object, peer, type, state, priority
+MAGIC = 0x52545452
+VERSION = 3
+
+# Trace::Type
+REGISTER, STATE, PRIORITY, CONTEXT_SWITCH, TICK = range(5)
+
+# Thread::State
+STATE_NAMES = [
+    'Reset', 'Paused', 'Ready', 'Running', 'Sleeping', 'SleepingAndPaused',
+    'BlockedByMutex', 'SoftBlockedByMutex', 'BlockedByMessage', 'SoftBlockedByMessage',
+    'BlockedByPool', 'SoftBlockedByPool', 'BlockedByNotification', 'SoftBlockedByNotification',
+    'Terminated',
+]
+MUTEX_STATES = {'BlockedByMutex', 'SoftBlockedByMutex'}
+MESSAGE_STATES = {'BlockedByMessage', 'SoftBlockedByMessage'}
+POOL_STATES = {'BlockedByPool', 'SoftBlockedByPool'}
+
+CORE_PID = 0
+THREAD_PID = 1
+
+
+def read_events(data):
+    magic, version, event_size, capacity, frequency, head, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC or version != VERSION or event_size != EVENT.size:
+        sys.exit('not a trace buffer (magic 0x%08x, version %d, event size %d)' % (magic, version, event_size))
+    if len(data) < HEADER.size + capacity * event_size:
+        sys.exit('truncated trace buffer')
+
+    count = min(head, capacity)
+    events = []
+    for index in range(head - count, head):
+        offset = HEADER.size + (index % capacity) * event_size
+        events.append(EVENT.unpack_from(data, offset))
+    return frequency, head - count, events
+
+
+def read_symbols(elf, nm):
+    symbols = {}
+    output = subprocess.run([nm, '--demangle', elf], check=True, capture_output=True, text=True).stdout
+    for line in output.splitlines():
+        fields = line.split(maxsplit=2)
+        if len(fields) == 3 and fields[1] in 'tT':
+            symbols[int(fields[0], 16) & 0xFFFFFFFE] = fields[2] # Clear the Thumb bit
+    return symbols
+
+
+class Converter:
+
+    def __init__(self, frequency, symbols):
+        self.frequency = frequency
+        self.symbols = symbols
+        self.output = []
+        self.thread_ids = {}      # Thread address -> track id
+        self.thread_names = {}    # Thread address -> name
+        self.thread_states = {}   # Thread address -> (state name, start time, args)
+        self.core_thread = None   # (thread address, start time)
+        self.flow_id = 0
+
+    def get_tid(self, thread, name=None):
+        if thread not in self.thread_ids:
+            tid = len(self.thread_ids) + 1
+            self.thread_ids[thread] = tid
+            self.name_thread(thread, name or 'thread 0x%08x' % thread)
+        elif name is not None:
+            self.name_thread(thread, name)
+        return self.thread_ids[thread]
+
+    def name_thread(self, thread, name):
+        self.thread_names[thread] = name
+        self.output.append({'ph': 'M', 'name': 'thread_name', 'pid': THREAD_PID, 'tid': self.thread_ids[thread], 'args': {'name': name}})
+
+    def thread_label(self, thread):
+        return 'thread 0x%08x' % thread
+
+    def add_flow(self, name, time, thread_from, thread_to):
+        self.flow_id += 1
+        self.output.append({'ph': 's', 'name': name, 'cat': 'flow', 'id': self.flow_id, 'ts': time, 'pid': THREAD_PID, 'tid': self.get_tid(thread_from)})
+        self.output.append({'ph': 'f', 'bp': 'e', 'name': name, 'cat': 'flow', 'id': self.flow_id, 'ts': time, 'pid': THREAD_PID, 'tid': self.get_tid(thread_to)})
+
+    def close_state(self, thread, time):
+        if thread in self.thread_states:
+            name, start, args = self.thread_states.pop(thread)
+            self.output.append({'ph': 'X', 'name': name, 'ts': start, 'dur': time - start, 'pid': THREAD_PID, 'tid': self.get_tid(thread), 'args': args})
+
+    def close_core(self, time):
+        if self.core_thread is not None:
+            thread, start = self.core_thread
+            self.output.append({'ph': 'X', 'name': self.thread_name(thread), 'ts': start, 'dur': time - start, 'pid': CORE_PID, 'tid': 0})
+            self.core_thread = None
+
+    def thread_name(self, thread):
+        return self.thread_names.get(thread, self.thread_label(thread))
+
+    def convert(self, first_index, events):
+        self.output.append({'ph': 'M', 'name': 'process_name', 'pid': CORE_PID, 'args': {'name': 'core'}})
+        self.output.append({'ph': 'M', 'name': 'process_name', 'pid': THREAD_PID, 'args': {'name': 'threads'}})
+
+        cycle = 0
+        last_raw = events[0][0] if events else 0
+        time = 0.0
+        for index, (raw, thread, obj, peer, kind, state, priority) in enumerate(events, first_index):
+            cycle += (raw - last_raw) & 0xFFFFFFFF # The counter wraps around
+            last_raw = raw
+            time = cycle * 1e6 / self.frequency
+
+            if kind == REGISTER:
+                if obj == 0:
+                    name = 'idle'
+                else:
+                    name = '%s (0x%08x)' % (self.symbols.get(obj & 0xFFFFFFFE, 'entry 0x%08x' % obj), thread)
+                self.get_tid(thread, name)
+
+            elif kind == STATE:
+                state_name = STATE_NAMES[state] if state < len(STATE_NAMES) else 'State%d' % state
+                args = {'priority': priority, 'event': index}
+                if state_name in MUTEX_STATES:
+                    args['mutex'] = '0x%08x' % obj
+                    if peer != 0:
+                        args['owner'] = self.thread_label(peer)
+                        self.add_flow('blocked by', time, thread, peer)
+                elif state_name in MESSAGE_STATES:
+                    args['queue'] = '0x%08x' % obj
+                elif state_name in POOL_STATES:
+                    args['pool'] = '0x%08x' % obj
+                elif state_name in ('Sleeping', 'SleepingAndPaused') or (state_name == 'Ready' and peer == 0 and obj != 0):
+                    args['expire_time'] = obj
+                elif state_name == 'Ready' and peer != 0:
+                    args['woken_by'] = self.thread_label(peer)
+                    args['object'] = '0x%08x' % obj
+                    self.add_flow('wakes', time, peer, thread)
+
+                self.close_state(thread, time)
+                self.get_tid(thread)
+                if state_name != 'Terminated':
+                    self.thread_states[thread] = (state_name, time, args)
+
+            elif kind == PRIORITY:
+                args = {'priority': priority}
+                if peer != 0 and peer != thread: # The running thread raised the priority of a mutex owner
+                    args['inherited_from'] = self.thread_label(peer)
+                self.output.append({'ph': 'i', 's': 't', 'name': 'priority %d' % priority, 'ts': time, 'pid': THREAD_PID, 'tid': self.get_tid(thread), 'args': args})
+
+            elif kind == CONTEXT_SWITCH:
+                self.close_core(time)
+                self.get_tid(thread)
+                self.core_thread = (thread, time)
+
+            elif kind == TICK:
+                self.output.append({'ph': 'i', 's': 't', 'name': 'tick', 'ts': time, 'pid': CORE_PID, 'tid': 0, 'args': {'time': obj}})
+
+        for thread in list(self.thread_states):
+            self.close_state(thread, time)
+        self.close_core(time)
+        return {'traceEvents': self.output, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert an RTOS trace buffer into Chrome/Perfetto trace JSON')
+    parser.add_argument('buffer', help='binary dump of the trace buffer')
+    parser.add_argument('-o', '--output', default='-', help='output JSON file (default: stdout)')
+    parser.add_argument('--elf', help='image to name the threads after their entry functions')
+    parser.add_argument('--nm', default='arm-none-eabi-nm', help='nm used with --elf (default: %(default)s)')
+    args = parser.parse_args()
+
+    with open(args.buffer, 'rb') as file:
+        data = file.read()
+    frequency, first_index, events = read_events(data)
+    symbols = read_symbols(args.elf, args.nm) if args.elf else {}
+
+    trace = Converter(frequency, symbols).convert(first_index, events)
+    if args.output == '-':
+        json.dump(trace, sys.stdout)
+    else:
+        with open(args.output, 'w') as file:
+            json.dump(trace, file)
+    print('%d events converted' % len(events), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()